@@ -0,0 +1,122 @@
+#ifndef HALFEDGEMESH_HPP
+#define HALFEDGEMESH_HPP
+
+#include <vector>
+#include <limits>
+#include <cstddef>
+#include <initializer_list>
+#include <glm.hpp>
+
+class Mesh;
+
+// HalfEdgeMesh : index based half-edge structure of a triangle mesh, stored as arrays (no pointers) with
+// 32-bit handles. Half-edge h = 3 * f + i goes from corner i to corner i + 1 of face f : its face, next and
+// previous half-edges are computed from the handle and only its origin vertex and its twin are stored. Each
+// vertex keeps one outgoing half-edge, the first one of its fan on a border (the one without twin).
+//
+// Edges shared by more than two faces, or by two faces of opposite orientations, are kept as borders on each
+// side (no twin) : a vertex may then have several fans, and is never collapsed. Collapses leave the removed
+// faces and vertices in the arrays until compact.
+//
+//            c
+//          /   ^
+//      p  /     \  n         h = 3f + i, n = next(h), p = prev(h) in face f
+//        v   f   \           twin(h) : half-edge b -> a of the face across the edge
+//       a -------> b
+//            h
+class HalfEdgeMesh {
+public:
+    static constexpr unsigned int NONE = std::numeric_limits<unsigned int>::max();
+
+    HalfEdgeMesh () = default;
+
+    // half-edges of the triangles of mesh in O(n) : a counting sort of the half-edges on the smaller vertex of their
+    // edge, then on the larger vertex within the short list of each vertex, puts the two half-edges of each edge
+    // side by side. In parallel, the result doesn't depend on the number of threads
+    explicit HalfEdgeMesh (const Mesh & mesh);
+
+    // the remaining faces and the vertices they reference, in their order, replace the mesh.
+    // Normals are computed again
+    void to_mesh (Mesh & mesh) const;
+
+    [[nodiscard]] unsigned int nb_vertices () const { return (unsigned int) m_outgoing.size(); }
+    [[nodiscard]] unsigned int nb_faces () const { return (unsigned int) m_face_removed.size(); }
+    [[nodiscard]] unsigned int nb_halfedges () const { return (unsigned int) m_origin.size(); }
+    // faces not removed by a collapse
+    [[nodiscard]] unsigned int nb_remaining_faces () const { return m_nb_remaining_faces; }
+
+    [[nodiscard]] static unsigned int face (unsigned int h) { return h / 3; }
+    [[nodiscard]] static unsigned int next (unsigned int h) { return h % 3 == 2 ? h - 2 : h + 1; }
+    [[nodiscard]] static unsigned int prev (unsigned int h) { return h % 3 == 0 ? h + 2 : h - 1; }
+    [[nodiscard]] unsigned int twin (unsigned int h) const { return m_twin[h]; }
+    [[nodiscard]] unsigned int origin (unsigned int h) const { return m_origin[h]; }
+    [[nodiscard]] unsigned int target (unsigned int h) const { return m_origin[next(h)]; }
+    [[nodiscard]] bool is_border (unsigned int h) const { return m_twin[h] == NONE; }
+
+    // outgoing half-edge of v, NONE when v is in no face
+    [[nodiscard]] unsigned int outgoing (unsigned int v) const { return m_outgoing[v]; }
+    [[nodiscard]] bool is_border_vertex (unsigned int v) const { return m_outgoing[v] != NONE && m_twin[m_outgoing[v]] == NONE; }
+    // all the faces around v are in the fan of outgoing(v)
+    [[nodiscard]] bool is_single_fan (unsigned int v) const;
+    [[nodiscard]] bool is_removed (unsigned int f) const { return m_face_removed[f] != 0; }
+
+    [[nodiscard]] glm::vec3 position (unsigned int v) const { return m_positions[v]; }
+    void set_position (unsigned int v, glm::vec3 position) { m_positions[v] = position; }
+
+    // call f(h) on the outgoing half-edges of v, turning from face to face across the twins. On a vertex with
+    // several fans (non manifold) only the fan of outgoing(v) is visited
+    template <typename F>
+    void for_each_outgoing (unsigned int v, F && f) const {
+        const unsigned int first = m_outgoing[v];
+        if (first == NONE) return;
+        unsigned int h = first;
+        do {
+            f(h);
+            h = m_twin[prev(h)];
+        } while (h != NONE && h != first);
+    }
+
+    // lists reused by the calls to can_collapse of one thread
+    struct Scratch {
+        std::vector<unsigned int> ring, other_ring;
+    };
+
+    // the collapse of h into its target keeps the mesh manifold (link condition) : the common neighbours of
+    // both ends are the opposite vertices of the faces of the edge, and an inner edge doesn't join two border vertices.
+    // The faces of the edge must not be a whole component (a tetrahedron would fold onto itself)
+    [[nodiscard]] bool can_collapse (unsigned int h, Scratch & scratch) const;
+
+    // collapse of h : its origin vertex is merged into its target, moved to position, and the faces of the edge
+    // are removed. Check can_collapse first
+    void collapse (unsigned int h, glm::vec3 position);
+
+    // drop the removed faces and the vertices in no remaining face, the handles of the others keep their order
+    void compact ();
+
+    // number of bytes held by the arrays
+    [[nodiscard]] size_t memory_usage () const {
+        return (m_origin.capacity() + m_twin.capacity() + m_outgoing.capacity() + m_nb_outgoing.capacity()) * sizeof(unsigned int) +
+               m_positions.capacity() * sizeof(glm::vec3) + m_face_removed.capacity();
+    }
+
+private:
+    // point outgoing(v) at the first of the half-edges given that is still in a face and leaves v,
+    // turned back to the first half-edge of its fan. NONE when there is none
+    void reset_outgoing (unsigned int v, std::initializer_list<unsigned int> candidates);
+
+    // id of each vertex referenced by a remaining face in the vertices kept, NONE for the others,
+    // and id of each remaining face in the faces kept. Returns the number of vertices kept
+    unsigned int remaining (std::vector<unsigned int> & vertex_ids, std::vector<unsigned int> & face_ids) const;
+
+    // vertices of the one-ring of v, in increasing order
+    void gather_ring (unsigned int v, std::vector<unsigned int> & ring) const;
+
+    std::vector<glm::vec3> m_positions;
+    std::vector<unsigned int> m_outgoing;              // per vertex
+    std::vector<unsigned int> m_nb_outgoing;           // per vertex, in the remaining faces
+    std::vector<unsigned int> m_origin, m_twin;        // per half-edge
+    std::vector<unsigned char> m_face_removed;         // per face
+    unsigned int m_nb_remaining_faces = 0;
+};
+
+#endif //HALFEDGEMESH_HPP
@@ -0,0 +1,106 @@
+#ifndef INDEXEDHEAP_HPP
+#define INDEXEDHEAP_HPP
+
+#include <vector>
+#include <cstddef>
+#include <limits>
+
+// IndexedHeap : binary min-heap of the ids [0, n) keyed by a cost. The position of each id in the heap
+// is kept, so the key of any id can be changed and any id removed in O(log n) without searching it.
+// Keys are stored in the heap entries, sifts compare contiguous entries instead of looking keys up by id.
+// Ties are broken by id : the order doesn't depend on the order of the insertions.
+class IndexedHeap {
+public:
+    static constexpr unsigned int NONE = std::numeric_limits<unsigned int>::max();
+
+    // heap of the ids [0, n) with the given keys, in O(n)
+    void build (const std::vector<double> & keys) {
+        m_heap.resize(keys.size());
+        m_position.resize(keys.size());
+        for (unsigned int id = 0; id < m_heap.size(); ++id) { m_heap[id] = Entry{keys[id], id}; m_position[id] = id; }
+        for (size_t i = m_heap.size() / 2; i-- > 0;) sift_down(i);
+    }
+
+    [[nodiscard]] bool empty () const { return m_heap.empty(); }
+    [[nodiscard]] size_t size () const { return m_heap.size(); }
+    [[nodiscard]] bool contains (unsigned int id) const { return m_position[id] != NONE; }
+
+    // id of the smallest key and its key
+    [[nodiscard]] unsigned int top () const { return m_heap[0].id; }
+    [[nodiscard]] double key (unsigned int id) const { return m_heap[m_position[id]].key; }
+
+    // insert id, or change its key when it is already in the heap
+    void update (unsigned int id, double key) {
+        if (!contains(id)) {
+            m_position[id] = (unsigned int) m_heap.size();
+            m_heap.push_back(Entry{key, id});
+            sift_up(m_heap.size() - 1);
+            return;
+        }
+        const double previous = m_heap[m_position[id]].key;
+        m_heap[m_position[id]].key = key;
+        if (key < previous) sift_up(m_position[id]);
+        else sift_down(m_position[id]);
+    }
+
+    void remove (unsigned int id) {
+        if (!contains(id)) return;
+        const size_t i = m_position[id];
+        m_position[id] = NONE;
+        const Entry last = m_heap.back();
+        m_heap.pop_back();
+        if (i == m_heap.size()) return;
+        m_heap[i] = last;
+        m_position[last.id] = (unsigned int) i;
+        sift_up(i);
+        sift_down(m_position[last.id]);
+    }
+
+    // number of bytes held by the heap
+    [[nodiscard]] size_t memory_usage () const {
+        return m_heap.capacity() * sizeof(Entry) + m_position.capacity() * sizeof(unsigned int);
+    }
+
+private:
+    struct Entry {
+        double key;
+        unsigned int id;
+    };
+
+    [[nodiscard]] static bool less (const Entry & a, const Entry & b) {
+        return a.key < b.key || (a.key == b.key && a.id < b.id);
+    }
+
+    void sift_up (size_t i) {
+        const Entry entry = m_heap[i];
+        while (i > 0) {
+            const size_t parent = (i - 1) / 2;
+            if (!less(entry, m_heap[parent])) break;
+            m_heap[i] = m_heap[parent];
+            m_position[m_heap[i].id] = (unsigned int) i;
+            i = parent;
+        }
+        m_heap[i] = entry;
+        m_position[entry.id] = (unsigned int) i;
+    }
+
+    void sift_down (size_t i) {
+        const Entry entry = m_heap[i];
+        const size_t n = m_heap.size();
+        while (2 * i + 1 < n) {
+            size_t child = 2 * i + 1;
+            if (child + 1 < n && less(m_heap[child + 1], m_heap[child])) ++child;
+            if (!less(m_heap[child], entry)) break;
+            m_heap[i] = m_heap[child];
+            m_position[m_heap[i].id] = (unsigned int) i;
+            i = child;
+        }
+        m_heap[i] = entry;
+        m_position[entry.id] = (unsigned int) i;
+    }
+
+    std::vector<Entry> m_heap;
+    std::vector<unsigned int> m_position;
+};
+
+#endif //INDEXEDHEAP_HPP
@@ -0,0 +1,189 @@
+#ifndef LINEAROCTREE_HPP
+#define LINEAROCTREE_HPP
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <glm.hpp>
+#include "Parallel.hpp"
+#include "TaskPool.hpp"
+
+// LinearOctree : pointerless octree built from the Morton codes of the vertices.
+// Vertices are sorted once by code, then every node is a contiguous range of the
+// sorted vertices and the 8 children of a node are consecutive in a flat node array.
+//
+// Children are numbered LeftBottomBack, RightBottomBack, LeftTopBack, RightTopBack, LeftBottomFront,
+// RightBottomFront, LeftTopFront, RightTopFront (bit 0 : high x, bit 1 : high y, bit 2 : low z)
+// and boxes are split at their float midpoints, so leaves are the same as the ones of the
+// recursive octree of Mesh::adaptiveSimplifyRecursive and come in the same depth-first order.
+class LinearOctree {
+public:
+    static constexpr unsigned int NONE = std::numeric_limits<unsigned int>::max();
+    // 3 bits per level on a 64-bit code
+    static constexpr unsigned int MAX_DEPTH = 21;
+    // nodes up to this number of vertices are built by a single task
+    static constexpr unsigned int SUBTREE_CUTOFF = 1u << 14;
+
+    struct Node {
+        glm::vec3 min, max;         // box of the node
+        unsigned int begin, end;    // range of the node in vertices()
+        unsigned int first_child;   // NONE for a leaf, children are first_child ... first_child + 7
+        unsigned int depth;
+
+        [[nodiscard]] bool is_leaf() const { return first_child == NONE; }
+        [[nodiscard]] unsigned int size() const { return end - begin; }
+        [[nodiscard]] bool contains(glm::vec3 p) const {
+            return p.x >= min.x && p.x <= max.x && p.y >= min.y && p.y <= max.y && p.z >= min.z && p.z <= max.z;
+        }
+    };
+
+    LinearOctree () = default;
+
+    // build the octree of the vertices vertex_ids inside the box [min, max] :
+    // a node is split while it holds more than max_per_leaf vertices
+    void build (const std::vector<glm::vec3> & positions, const std::vector<unsigned int> & vertex_ids,
+                glm::vec3 min, glm::vec3 max, unsigned int max_per_leaf) {
+        m_nodes.clear();
+        m_leaves.clear();
+        m_vertices = vertex_ids;
+        m_max_per_leaf = max_per_leaf;
+
+        // sort vertices by Morton code
+        std::vector<uint64_t> codes(m_vertices.size());
+        parallel_for(m_vertices.size(), 1 << 14, [&](size_t i){ codes[i] = code(positions[m_vertices[i]], min, max); });
+        parallel_radix_sort(codes, m_vertices, 3 * MAX_DEPTH);
+
+        // split the nodes bigger than SUBTREE_CUTOFF breadth first, the smaller ones
+        // are the roots of subtrees built by independent tasks
+        auto splittable = [max_per_leaf](const Node & node){ return node.size() > max_per_leaf && node.depth < MAX_DEPTH; };
+        std::vector<unsigned int> subtree_roots;
+        m_nodes.push_back(Node{min, max, 0, (unsigned int) m_vertices.size(), NONE, 0});
+        for (size_t n = 0; n < m_nodes.size(); ++n) {
+            if (!splittable(m_nodes[n])) continue;
+            if (m_nodes[n].size() <= SUBTREE_CUTOFF) { subtree_roots.push_back((unsigned int) n); continue; }
+            m_nodes[n].first_child = (unsigned int) m_nodes.size();
+            split(m_nodes[n], codes, m_nodes);
+        }
+
+        // each subtree is built in its own node list, starting with a copy of its root
+        std::vector<std::vector<Node>> subtrees(subtree_roots.size());
+        TaskPool & pool = TaskPool::instance();
+        TaskPool::Group group;
+        for (size_t s = 0; s < subtree_roots.size(); ++s) {
+            pool.run(group, [&, s](){
+                std::vector<Node> & nodes = subtrees[s];
+                nodes.push_back(m_nodes[subtree_roots[s]]);
+                for (size_t n = 0; n < nodes.size(); ++n) {
+                    if (!splittable(nodes[n])) continue;
+                    nodes[n].first_child = (unsigned int) nodes.size();
+                    split(nodes[n], codes, nodes);
+                }
+            });
+        }
+        pool.wait(group);
+
+        // append the subtrees in order so that the layout doesn't depend on the tasks
+        for (size_t s = 0; s < subtree_roots.size(); ++s) {
+            const unsigned int offset = (unsigned int) m_nodes.size() - 1;
+            m_nodes[subtree_roots[s]].first_child = subtrees[s][0].first_child + offset;
+            for (size_t n = 1; n < subtrees[s].size(); ++n) {
+                Node node = subtrees[s][n];
+                if (!node.is_leaf()) node.first_child += offset;
+                m_nodes.push_back(node);
+            }
+            std::vector<Node>().swap(subtrees[s]);
+        }
+
+        // non-empty leaves in the order of their vertices : leaves are disjoint ranges of the vertices
+        std::vector<unsigned int> leaf_at(m_vertices.size() + 1, NONE);
+        parallel_for(m_nodes.size(), 1 << 14, [&](size_t n){
+            if (m_nodes[n].is_leaf() && m_nodes[n].size() > 0) leaf_at[m_nodes[n].begin] = (unsigned int) n;
+        });
+        for (unsigned int leaf : leaf_at) if (leaf != NONE) m_leaves.push_back(leaf);
+
+        // vertices of a leaf in increasing order, so that they don't depend on the way the leaf was found
+        task_parallel_for(m_leaves.size(), 1 << 10, [&](size_t l){
+            const Node & leaf = m_nodes[m_leaves[l]];
+            std::sort(m_vertices.begin() + leaf.begin, m_vertices.begin() + leaf.end);
+        });
+    }
+
+    // Morton code of a position : one digit per level, the digit being the child of the node containing it.
+    // A position on a midpoint goes with high x, high y and low z
+    static uint64_t code (glm::vec3 p, glm::vec3 min, glm::vec3 max) {
+        uint64_t code = 0;
+        float x0 = min.x, x1 = max.x, y0 = min.y, y1 = max.y, z0 = min.z, z1 = max.z;
+        for (unsigned int depth = 0; depth < MAX_DEPTH; ++depth) {
+            float xm = x0 + (x1 - x0) / 2.0f, ym = y0 + (y1 - y0) / 2.0f, zm = z0 + (z1 - z0) / 2.0f;
+            // selects rather than branches : the digits of close vertices are not predictable
+            bool high_x = p.x >= xm, high_y = p.y >= ym, low_z = p.z <= zm;
+            x0 = high_x ? xm : x0; x1 = high_x ? x1 : xm;
+            y0 = high_y ? ym : y0; y1 = high_y ? y1 : ym;
+            z0 = low_z ? z0 : zm;  z1 = low_z ? zm : z1;
+            code = (code << 3) | (uint64_t) high_x | ((uint64_t) high_y << 1) | ((uint64_t) low_z << 2);
+        }
+        return code;
+    }
+
+    [[nodiscard]] const std::vector<Node> & nodes () const { return m_nodes; }
+    [[nodiscard]] const Node & node (unsigned int n) const { return m_nodes[n]; }
+
+    // ids of the non-empty leaves in depth-first order
+    [[nodiscard]] const std::vector<unsigned int> & leaves () const { return m_leaves; }
+
+    // ids of the non-empty leaves, in depth-first order, of the octree built on the same vertices with a
+    // larger max_per_leaf : nodes of at most max_per_leaf vertices are not split, so these leaves are a cut
+    // of the tree. Vertices of a node of the cut that isn't a leaf are not sorted by id
+    void cut (unsigned int max_per_leaf, std::vector<unsigned int> & leaves) const {
+        leaves.clear();
+        if (m_nodes.empty()) return;
+        std::vector<unsigned int> stack(1, 0);
+        while (!stack.empty()) {
+            const unsigned int n = stack.back();
+            stack.pop_back();
+            const Node & node = m_nodes[n];
+            if (node.size() == 0) continue;
+            if (node.is_leaf() || node.size() <= max_per_leaf) { leaves.push_back(n); continue; }
+            for (unsigned int child = 8; child-- > 0;) stack.push_back(node.first_child + child);
+        }
+    }
+
+    // max_per_leaf of the last build
+    [[nodiscard]] unsigned int max_per_leaf () const { return m_max_per_leaf; }
+
+    // vertex ids sorted by Morton code then by id inside a leaf, nodes are ranges of this list
+    [[nodiscard]] const std::vector<unsigned int> & vertices () const { return m_vertices; }
+
+    // number of bytes held by the octree
+    [[nodiscard]] size_t memory_usage () const {
+        return m_nodes.capacity() * sizeof(Node) + (m_leaves.capacity() + m_vertices.capacity()) * sizeof(unsigned int);
+    }
+
+private:
+    // append the 8 children of node to nodes, the children are found by binary search on the codes
+    static void split (Node node, const std::vector<uint64_t> & codes, std::vector<Node> & nodes) {
+        const unsigned int shift = 3 * (MAX_DEPTH - 1 - node.depth);
+        const glm::vec3 middle = node.min + (node.max - node.min) / 2.0f;
+
+        unsigned int begin = node.begin;
+        for (unsigned int child = 0; child < 8; ++child) {
+            unsigned int end = (unsigned int) (std::upper_bound(codes.begin() + begin, codes.begin() + node.end, child,
+                [shift](unsigned int digit, uint64_t c){ return digit < ((c >> shift) & 7); }) - codes.begin());
+
+            Node child_node{node.min, node.max, begin, end, NONE, node.depth + 1};
+            if (child & 1) child_node.min.x = middle.x; else child_node.max.x = middle.x;
+            if (child & 2) child_node.min.y = middle.y; else child_node.max.y = middle.y;
+            if (child & 4) child_node.max.z = middle.z; else child_node.min.z = middle.z;
+            nodes.push_back(child_node);
+            begin = end;
+        }
+    }
+
+    std::vector<Node> m_nodes;
+    std::vector<unsigned int> m_leaves;
+    std::vector<unsigned int> m_vertices;
+    unsigned int m_max_per_leaf = 0;
+};
+
+#endif //LINEAROCTREE_HPP
@@ -0,0 +1,73 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+
+#if defined(__linux__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define MESH_HAS_MMAP
+#endif
+
+// read-only content of a file, memory-mapped when the platform allows it
+// and read in a buffer otherwise
+class MappedFile {
+public:
+    explicit MappedFile(const std::string & filename)
+    {
+#ifdef MESH_HAS_MMAP
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st{};
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void * mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED)
+            {
+                madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+                m_data = (const char *) mapped;
+                m_size = st.st_size;
+                m_mapped = true;
+            }
+        }
+        close(fd);
+#endif
+        if (!m_mapped)
+        {
+            std::ifstream file(filename.c_str(), std::ios::binary);
+            if (!file.is_open()) return;
+            m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            m_data = m_buffer.data();
+            m_size = m_buffer.size();
+        }
+        m_valid = true;
+    }
+
+    ~MappedFile()
+    {
+#ifdef MESH_HAS_MMAP
+        if (m_mapped) munmap((void *) m_data, m_size);
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator=(const MappedFile &) = delete;
+
+    bool valid() const {return m_valid;}
+    const char * begin() const {return m_data;}
+    const char * end() const {return m_data + m_size;}
+    size_t size() const {return m_size;}
+
+private:
+    const char * m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false, m_valid = false;
+    std::vector<char> m_buffer;
+};
+
+#endif //MAPPEDFILE_HPP
@@ -10,12 +10,25 @@
 #include <float.h>
 #include <algorithm>
 #include <memory>
+#include <functional>
 // Include GLM
 #include <glm.hpp>
 #include <gtc/matrix_transform.hpp>
 #include <gtx/transform.hpp>
-#include "Octree.hpp"
+#include "LinearOctree.hpp"
+#include "Quadric.hpp"
+#include "NormalEngine.hpp"
 #include <unordered_map>
+#include <limits>
+#include <mutex>
+
+// type of the indices stored in the mesh, selected at compile time:
+// 32 bits by default, define MESH_INDEX_16BIT for small meshes (< 65,536 vertices)
+#ifdef MESH_INDEX_16BIT
+typedef unsigned short mesh_index;
+#else
+typedef unsigned int mesh_index;
+#endif
 
 // BOX structure for bounding box
 struct BOX {
@@ -25,11 +38,124 @@ struct BOX {
     glm::vec3 dimension() {return glm::vec3(xpos.y - xpos.x, ypos.y - ypos.x, zpos.y - zpos.x);}
 };
 
+// placement of the representative vertex of a cell of the grid simplification :
+// AVERAGE of the cell vertices, or minimum of the QUADRIC error of the planes of the
+// triangles around them, clamped to the cell
+enum class GridPlacement { AVERAGE, QUADRIC };
+
+// Triangle : view on the three consecutive indices of a triangle
+// stored in a flat index list (no copy, no allocation)
+struct Triangle {
+    Triangle(const std::vector<mesh_index> & indices, unsigned int t) : v(&indices[3 * t]) {}
+    mesh_index operator[](unsigned int i) const {return v[i];}
+    const mesh_index * v;
+};
+
+// MeshAdjacency : vertex -> triangle and vertex -> vertex adjacency of a flat index list,
+// stored in compressed sparse row form (one offset per vertex into a single list).
+// The triangles around a vertex are given by their corners 3 * t + i (the vertex is corner i of
+// triangle t) in increasing order, its neighbours are the distinct vertices sharing a triangle
+// with it, in increasing order.
+class MeshAdjacency {
+public:
+    // build both lists with counting passes over the corners then over the vertices
+    void build (const std::vector<mesh_index> & indices, unsigned int nb_vertices);
+
+    void clear ();
+
+    // true when the lists were built for nb_vertices vertices and nb_indices indices
+    [[nodiscard]] bool matches (size_t nb_vertices, size_t nb_indices) const {
+        return !m_corners_start.empty() && m_corners_start.size() == nb_vertices + 1 && m_corners.size() == nb_indices;
+    }
+
+    [[nodiscard]] unsigned int getNumberOfVertices () const {
+        return m_corners_start.empty() ? 0 : (unsigned int) m_corners_start.size() - 1;
+    }
+
+    // corners of the triangles around v
+    [[nodiscard]] const unsigned int * corners_begin (unsigned int v) const { return m_corners.data() + m_corners_start[v]; }
+    [[nodiscard]] const unsigned int * corners_end (unsigned int v) const { return m_corners.data() + m_corners_start[v + 1]; }
+    [[nodiscard]] unsigned int nb_triangles (unsigned int v) const { return m_corners_start[v + 1] - m_corners_start[v]; }
+
+    // vertices of the one-ring of v
+    [[nodiscard]] const mesh_index * neighbours_begin (unsigned int v) const { return m_neighbours.data() + m_neighbours_start[v]; }
+    [[nodiscard]] const mesh_index * neighbours_end (unsigned int v) const { return m_neighbours.data() + m_neighbours_start[v + 1]; }
+    [[nodiscard]] unsigned int valence (unsigned int v) const { return m_neighbours_start[v + 1] - m_neighbours_start[v]; }
+
+    // number of bytes held by the lists
+    [[nodiscard]] size_t memory_usage () const {
+        return (m_corners_start.capacity() + m_corners.capacity() + m_neighbours_start.capacity()) * sizeof(unsigned int) +
+               m_neighbours.capacity() * sizeof(mesh_index);
+    }
+
+private:
+    std::vector<unsigned int> m_corners_start, m_corners;
+    std::vector<unsigned int> m_neighbours_start;
+    std::vector<mesh_index> m_neighbours;
+};
+
+class Mesh;
+
+// LODChain : levels of detail of a mesh, from the finest to the coarsest, sharing one vertex buffer.
+// The triangles of level l are indices[level_start[l]] ... indices[level_start[l + 1] - 1], into vertices
+struct LODChain {
+    std::vector<glm::vec3> vertices;
+    std::vector<mesh_index> indices;
+    std::vector<size_t> level_start;
+
+    [[nodiscard]] unsigned int getNumberOfLevels () const { return level_start.empty() ? 0 : (unsigned int) level_start.size() - 1; }
+    [[nodiscard]] unsigned int getNumberOfTriangles (unsigned int level) const {
+        return (unsigned int) ((level_start[level + 1] - level_start[level]) / 3);
+    }
+
+    // level as a mesh of its own : the vertices it uses in their order, normals computed again
+    void extract (unsigned int level, Mesh & mesh) const;
+};
+
+// ProgressiveMesh : a coarse base mesh and the vertex splits refining it back to the mesh it was decimated from
+// (Hoppe, Progressive Meshes, 1996), to send the base first and then the splits in order. Vertices and triangles
+// are numbered so that the mesh after k splits is a prefix of both : split k adds vertex nb_base_vertices + k
+// and the triangles up to its triangle_end, stored in indices as they appear. Moving between two states only
+// touches the splits in between
+struct ProgressiveMesh {
+    // inverse of the collapse of the new vertex into parent
+    struct VertexSplit {
+        unsigned int parent;
+        unsigned int triangle_end;          // number of triangles after the split
+        unsigned int corner_end;            // its corners end at corners[corner_end - 1], after the previous ones
+        glm::vec3 parent_position;          // after the split
+        glm::vec3 collapsed_position;       // of parent before the split
+    };
+
+    unsigned int nb_base_vertices = 0, nb_base_triangles = 0;
+    std::vector<VertexSplit> splits;
+    // corner c of triangle t is 3 * t + c, these corners of parent move to the new vertex
+    std::vector<unsigned int> corners;
+
+    // current state, after nb_applied splits : the first getNumberOfVertices() vertices and the first
+    // getNumberOfTriangles() triangles are in use
+    std::vector<glm::vec3> vertices;
+    std::vector<mesh_index> indices;
+    unsigned int nb_applied = 0;
+
+    [[nodiscard]] unsigned int getNumberOfVertices () const { return nb_base_vertices + nb_applied; }
+    [[nodiscard]] unsigned int getNumberOfTriangles () const {
+        return nb_applied == 0 ? nb_base_triangles : splits[nb_applied - 1].triangle_end;
+    }
+
+    // apply or undo splits until nb_vertices vertices are in use, clamped to the base and to the full mesh
+    void setNumberOfVertices (unsigned int nb_vertices);
+
+    // current state as a mesh of its own, normals computed again
+    void extract (Mesh & mesh) const;
+};
+
 class Mesh {
 public:
     // constructors
     Mesh();
-    Mesh(const char * filename);
+    // @use_cache : read / write the binary cache stored next to the OFF file
+    Mesh(const char * filename, bool use_cache = true);
     // destructor
     ~Mesh();
 
@@ -37,80 +163,189 @@ public:
     // @weight_type : 0 for uniform, 1 for area of triangles, 2 for angle of triangle
     void compute_smooth_vertex_normals(int weight_type);
 
+    // same with the weighting scheme UniformWeight, AreaWeight or AngleWeight chosen at compile time
+    template <typename Weight>
+    void compute_smooth_vertex_normals() {
+        m_normal_engine.compute<Weight>(indexed_vertices, indices, adjacency(), indexed_normals);
+    }
+
     // calculate the number of neighbors of a vertex and
     // normalize it depending on maximum valence of the mesh
     void compute_vertex_valences();
 
-    // simplify vertices of the mesh this based on given resolution
-    void simplify (unsigned int resolution);
+    // simplify vertices of the mesh this based on given resolution,
+    // vertices are grouped by cell with a parallel radix sort so that
+    // only cells of the grid containing vertices are stored
+    void simplify (unsigned int resolution, GridPlacement placement = GridPlacement::AVERAGE);
+
+    // simplify the mesh on a grid to at most target_triangles triangles : the vertices are sorted once by the
+    // Morton key of their cell in a fine grid, so the grid of resolution 2^depth is a prefix of the keys and the
+    // finest depth within the target is found by a binary search with one counting pass over the triangles per
+    // probe. Cells of that grid are then split once, the largest first, while the target holds.
+    // Returns the resolution of the grid before the splits, 0 when the mesh already had at most target_triangles
+    unsigned int simplifyToTarget (unsigned int target_triangles, GridPlacement placement = GridPlacement::AVERAGE);
+
+    // simplify the mesh of an OFF file (or of its binary cache) on a grid without loading it, for meshes
+    // larger than memory : one streaming pass over the file accumulates the plane quadrics of the
+    // triangles in the occupied cells, the cell representatives minimise them (see MeshStream).
+    // The result replaces the mesh. Fails when the buffers would exceed memory_budget bytes : they
+    // depend on the resolution, and on the number of vertices when they can't be held in memory
+    bool simplifyStreaming (const std::string & filename, unsigned int resolution, size_t memory_budget, bool use_cache = true);
+
+    // same as simplify but allocates the resolution^3 cells of the grid,
+    // kept as a reference for low resolutions
+    void simplifyDense (unsigned int resolution);
 
     // simplify vertices of the mesh this based on octree
     // @numOfPerLeafVertices :  number of vertices per leaf
+    // The octree is built once down to OCTREE_LEAF_SIZE vertices per leaf and kept with the representative
+    // vertex of each node already used, shared by the copies of the mesh until its triangles change : the
+    // leaves of any larger number of vertices per leaf are a cut of it, the result is the same as with a new octree
     void adaptiveSimplify (unsigned int numOfPerLeafVertices);
 
+    // vertices per leaf of the octree kept by adaptiveSimplify (smaller values rebuild it)
+    static constexpr unsigned int OCTREE_LEAF_SIZE = 4;
+
+    // same as adaptiveSimplify on a recursive octree partitioning the vertices in place,
+    // kept as a reference for the linear octree
+    void adaptiveSimplifyRecursive (unsigned int numOfPerLeafVertices);
+
+    // error-driven simplification by edge collapses (Garland and Heckbert) : each vertex has the quadric of
+    // the planes of its triangles, the cheapest collapse is applied first at the minimum of the summed quadrics.
+    // Collapses breaking the link condition (which keeps a manifold mesh manifold) or turning a triangle over
+    // are refused. Stops at target_triangles triangles or when the next collapse would cost more than
+    // max_error, a sum of squared distances to the planes of the merged triangles (see MeshDecimation.cpp)
+    void decimate (unsigned int target_triangles, double max_error = std::numeric_limits<double>::infinity());
+
+    // same as decimate by rounds of collapses applied in parallel : each round keeps the cheapest quarter of the
+    // collapses, and among them the ones cheapest over all the vertices they touch, so that no two of them share
+    // a vertex. Only the vertices around the collapses are evaluated again. Returns the number of collapses of
+    // each round, the result doesn't depend on the number of threads
+    std::vector<unsigned int> decimateParallel (unsigned int target_triangles, double max_error = std::numeric_limits<double>::infinity());
+
+    // nb_levels levels of detail in one pass of edge collapses (see decimate) : level 0 is the mesh, level l has at
+    // most ratio^l times its triangles and is decimated from level l - 1, with 0 < ratio < 1. A vertex is stored
+    // once for all the consecutive levels that don't move it. The mesh isn't changed, the chain is empty when the
+    // ratio is out of range or the vertices don't fit in the mesh index type
+    LODChain buildLODChain (unsigned int nb_levels, float ratio = 0.5f);
+
+    // progressive mesh from the collapses of decimate down to base_triangles : its base is the decimated mesh
+    // and each split undoes one collapse, the last collapse first. The mesh isn't changed
+    ProgressiveMesh buildProgressiveMesh (unsigned int base_triangles);
+
 
     // variables of a mesh
     //
     // P0 ---- P1       indices :           0 1 2 1 2 3
-    //  \    /  \       triangles:          (0, 1, 2) (1, 2, 3)
+    //  \    /  \       triangle(t):        (0, 1, 2) (1, 2, 3)
     //   \  /    \      indexed_vertices:   P0 P1 P2 P3
     //    P2 --- P3     valences:            2  3  3  2
     //
     int weight = 0;
     std::vector<float> valence_field;
-    std::vector<unsigned short> indices;
+    std::vector<mesh_index> indices;
     std::vector<unsigned int> valences;
     std::vector<glm::vec3> indexed_vertices, indexed_normals;
     std::vector<glm::vec2> indexed_uvs;
-    std::vector<std::vector<unsigned short> > triangles;
     BOX bounding_box;
 
     unsigned int getNumberOfVertices(){return indexed_vertices.size();}
+    unsigned int getNumberOfTriangles() const {return indices.size() / 3;}
+    Triangle triangle(unsigned int t) const {return Triangle(indices, t);}
 
-private:
-    // pointer to octree
-    std::shared_ptr<Octree> m_octree;
+    // vertex -> triangle and vertex -> vertex adjacency of the mesh, built on first use and
+    // shared by the valences, the normals and the simplifications until the triangles change
+    const MeshAdjacency & adjacency();
+
+    // the buffers were edited in place : the adjacency and the octree built for them are dropped and the
+    // generation of the mesh changes. The methods of Mesh changing the buffers call it themselves
+    void clear_caches ();
+
+    // number of bytes held by the mesh buffers
+    size_t memory_usage() const;
+
+    // print memory held by the mesh, in total and per triangle
+    void memory_report() const;
 
+    // write vertices and triangles in an OFF file, text is formatted in parallel
+    bool write_OFF_file(const std::string & filename) const;
+
+    // path of the binary cache of the OFF file filename
+    static std::string cache_filename(const std::string & filename);
+
+private:
     // normalize valences using maximul valence of the mesh
     void generate_valence_field ();
 
-    // compute normals for each triangles and stock in triangle_normals
-    void compute_triangle_normals ( const std::vector<glm::vec3> & vertices,
-                                    const std::vector<std::vector<unsigned short> > & triangles,
-                                    std::vector<glm::vec3> & triangle_normals);
+    // representative vertex of the cluster (octree leaf or grid cell) of box [min, max] and index cluster in vertices_to_repr,
+    // minimising the quadric error of the planes of the triangles around the cluster vertices, or their average when the
+    // minimum is not unique. A minimum outside of the box is clamped to it with clamp, replaced by the average otherwise
+    glm::vec3 cluster_representative (glm::vec3 min, glm::vec3 max, unsigned int cluster, const unsigned int * cluster_vertices,
+                                      unsigned int nb_cluster_vertices, const std::vector<unsigned int> & vertices_to_repr,
+                                      const MeshAdjacency & adjacency, bool clamp);
 
-    // compute normals for each vertex depending on weight_type criteria
-    // and stock in vertex_normals
-    // @weight_type : 0 for uniform, 1 for area of triangles, 2 for angle of triangle
-    void compute_smooth_vertex_normals (const std::vector<glm::vec3> & vertices,
-                                        const std::vector<std::vector<unsigned short> > & triangles,
-                                        unsigned int weight_type,
-                                        std::vector<glm::vec3> & vertex_normals);
-
-    // create a list of numbers of vertices around each one
-    void collect_one_ring ( const std::vector<glm::vec3> & vertices,
-                            const std::vector<std::vector<unsigned short> > & triangles,
-                            std::vector<std::vector<unsigned short> > & one_ring) ;
-
-    // assign number of vertices around to corresponding vertex
-    void compute_vertex_valences (  const std::vector<glm::vec3> & vertices,
-                                    const std::vector<std::vector<unsigned short> > & triangles,
-                                    std::vector<unsigned int> & valences) ;
-
-    // recursive function of adaptiveSimplify function
-    // using the Quadratic Error Function
-    void adaptiveSimplifyRec (std::shared_ptr<Octree> oc, unsigned int numOfPerLeafVertices, std::vector<unsigned int> & vertices_to_repr, std::vector<glm::vec3> & repr_indexed_vertices, std::vector<std::vector<unsigned short>> in_triangles);
-
-    // load file of format OFF with given filename
+    // octree of the referenced vertices kept between adaptive simplifications, for the triangles it was built on
+    struct OctreeCache {
+        std::mutex mutex;
+        LinearOctree octree;
+        uint64_t generation = 0;            // of the mesh the octree was built for
+        // representative vertex of each node, once it has been a leaf
+        std::vector<glm::vec3> representatives;
+        std::vector<unsigned char> computed;
+    };
+
+    // representative vertex of each octree leaf, leaves being ranges of vertices given in their final order.
+    // With a cache the leaves are the nodes leaf_nodes of its octree and their representatives are kept
+    void compute_leaf_representatives ( const std::vector<unsigned int> & vertices,
+                                        const std::vector<LinearOctree::Node> & leaves,
+                                        std::vector<unsigned int> & vertices_to_repr,
+                                        std::vector<glm::vec3> & repr_indexed_vertices,
+                                        const std::vector<unsigned int> * leaf_nodes = nullptr,
+                                        OctreeCache * cache = nullptr);
+
+    // recursive function of adaptiveSimplifyRecursive function : vertices [begin, end) of vertex_ids in the node
+    // of box [min, max] are partitioned in place between its children. Leaves are added to task_leaves,
+    // subtrees bigger than LinearOctree::SUBTREE_CUTOFF are new tasks of group adding their leaves to leaves
+    void adaptiveSimplifyRec (glm::vec3 min, glm::vec3 max, unsigned int depth, unsigned int * vertex_ids, unsigned int begin, unsigned int end,
+                              unsigned int numOfPerLeafVertices, TaskPool & pool, TaskPool::Group & group,
+                              std::mutex & leaves_mutex, std::vector<LinearOctree::Node> & leaves,
+                              std::vector<LinearOctree::Node> & task_leaves);
+
+    // ids of the vertices referenced by at least one triangle, in increasing order
+    void collect_referenced_vertices (std::vector<unsigned int> & vertex_ids) const;
+
+    // replace the vertices by one representative per cluster and keep the triangles joining three clusters,
+    // clusters are the ranges [cluster_start[c], cluster_start[c + 1]) of sorted_vertices and cluster_box
+    // gives the box of a cluster for the quadric placement
+    void replace_by_clusters (const std::vector<unsigned int> & sorted_vertices, const std::vector<unsigned int> & cluster_start,
+                              GridPlacement placement, const std::function<void (size_t, glm::vec3 &, glm::vec3 &)> & cluster_box);
+
+    // indices of the triangles whose vertices have three different representative vertices
+    void collapse_triangles (const std::vector<unsigned int> & vertex_to_repr, std::vector<mesh_index> & repr_indices) const;
+
+    // load mesh buffers from the binary cache of filename, fails if the cache is missing,
+    // corrupted or older than the OFF file
+    bool load_cache_file(const std::string & filename);
+
+    // write mesh buffers in the binary cache of filename
+    bool write_cache_file(const std::string & filename) const;
+
+    // load file of format OFF with given filename (memory-mapped and parsed in parallel)
     bool load_OFF_file (const std::string & filename, std::vector< glm::vec3 > & vertices,
-                        std::vector< glm::vec3 > & normals, std::vector< unsigned short > & indices,
-                        std::vector< std::vector<unsigned short > > & triangles, glm::vec2 & xpos,
+                        std::vector< glm::vec3 > & normals, std::vector< mesh_index > & indices, glm::vec2 & xpos,
                         glm::vec2 & ypos, glm::vec2 & zpos);
 
     // calculate plane equation using 3 vertices
     glm::vec4 equation_plane(float x1, float y1, float z1,
                              float x2, float y2, float z2,
                              float x3, float y3, float z3);
+
+    // changed by clear_caches, the adjacency and the octree built for another generation are stale
+    uint64_t m_generation = 0;
+    MeshAdjacency m_adjacency;
+    uint64_t m_adjacency_generation = 0;
+    std::shared_ptr<OctreeCache> m_octree_cache = std::make_shared<OctreeCache>();
+    NormalEngine m_normal_engine;
 };
 
 #endif
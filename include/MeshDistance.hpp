@@ -0,0 +1,36 @@
+#ifndef MESHDISTANCE_HPP
+#define MESHDISTANCE_HPP
+
+#include <vector>
+#include <glm.hpp>
+#include "Mesh.hpp"
+
+// MeshDistance : distance from points to the surface of a mesh. The triangles are binned in a
+// uniform grid of about one cell per triangle (a triangle is in every cell its box overlaps),
+// a query visits the rings of cells around the point until no closer triangle can be found.
+class MeshDistance {
+public:
+    // the triangles are copied, the mesh can change afterwards
+    explicit MeshDistance (const Mesh & mesh);
+
+    // distance from p to the closest triangle, infinity when the mesh has no triangle
+    [[nodiscard]] float distance (glm::vec3 p) const;
+
+    // largest distance from the surface of mesh to this surface, sampled at the corners,
+    // the middle of the edges and the centroid of each triangle of mesh, in parallel
+    [[nodiscard]] float max_distance (const Mesh & mesh) const;
+
+    // symmetric Hausdorff distance between the surfaces of a and b (sampled like max_distance)
+    static float hausdorff (const Mesh & a, const Mesh & b);
+
+private:
+    // squared distance from p to the triangle t
+    [[nodiscard]] float squared_distance (glm::vec3 p, unsigned int t) const;
+
+    std::vector<glm::vec3> m_corners;               // 3 corners per triangle
+    glm::vec3 m_min = glm::vec3(0.0f), m_cell_size = glm::vec3(1.0f);
+    glm::ivec3 m_resolution = glm::ivec3(0);
+    std::vector<unsigned int> m_cell_start, m_cell_triangles;
+};
+
+#endif //MESHDISTANCE_HPP
@@ -0,0 +1,73 @@
+#ifndef MESHGENERATOR_HPP
+#define MESHGENERATOR_HPP
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <glm.hpp>
+
+class Mesh;
+
+// MeshGenerator : deterministic procedural meshes for scaling tests, from thousands to hundreds
+// of millions of triangles. Every vertex and every triangle is computed from its id alone, so
+// meshes are generated in parallel, or written to an OFF file block by block without holding
+// the mesh in memory, and are the same for a given shape, size and seed on any machine.
+//
+// ICOSPHERE : unit sphere, each face of an icosahedron subdivided in n^2 triangles (20 n^2 triangles)
+// TERRAIN   : heightfield of fractal value noise on a regular grid of w^2 cells (2 w^2 triangles)
+// SOUP      : many small closed noisy spheres scattered in the unit cube, like the parts of a scan
+//             (320 triangles per component)
+class MeshGenerator {
+public:
+    enum Shape { ICOSPHERE, TERRAIN, SOUP };
+
+    // shape with the size allowed by the shape closest to nb_triangles triangles
+    MeshGenerator (Shape shape, size_t nb_triangles, uint32_t seed = 0);
+
+    // shape from its name ("icosphere", "terrain" or "soup"), false if unknown
+    static bool parse_shape (const std::string & name, Shape & shape);
+    static const char * shape_name (Shape shape);
+
+    [[nodiscard]] size_t getNumberOfVertices () const { return m_nb_vertices; }
+    [[nodiscard]] size_t getNumberOfTriangles () const { return m_nb_triangles; }
+
+    // position and unit normal of vertex v
+    void vertex (size_t v, glm::vec3 & position, glm::vec3 & normal) const;
+
+    // vertices of triangle t, counter-clockwise seen from outside
+    void triangle (size_t t, size_t corners[3]) const;
+
+    // fill the buffers and the bounding box of mesh, in parallel.
+    // Fails when the vertices don't fit in the mesh index type
+    bool generate (Mesh & mesh) const;
+
+    // write the mesh in an OFF file : blocks of vertices and triangles are formatted
+    // in parallel and written one after the other, memory doesn't depend on the size
+    bool write_OFF_file (const std::string & filename) const;
+
+private:
+    // vertex id of the lattice point (i, j) of face f of an icosphere of frequency n :
+    // corners, then vertices inside the edges, then vertices inside the faces
+    size_t lattice_vertex (unsigned int n, unsigned int f, unsigned int i, unsigned int j) const;
+    // unit position of vertex v of an icosphere of frequency n
+    glm::vec3 icosphere_vertex (unsigned int n, size_t v) const;
+    // vertices of triangle t of an icosphere of frequency n
+    void icosphere_triangle (unsigned int n, size_t t, size_t corners[3]) const;
+
+    // fractal value noise in [-1, 1] at (x, y)
+    float terrain_height (float x, float y) const;
+
+    Shape m_shape;
+    uint32_t m_seed;
+    unsigned int m_n;                   // icosphere frequency, terrain cells per side, components of the soup
+    size_t m_nb_vertices, m_nb_triangles;
+
+    // icosahedron : corners, faces (counter-clockwise seen from outside) and edges (lower corner first)
+    glm::vec3 m_corners[12];
+    unsigned int m_faces[20][3];
+    unsigned int m_edges[30][2];
+    // edge of each side of each face : side 0 is corners 0 1, side 1 is 0 2, side 2 is 1 2
+    unsigned int m_face_edges[20][3];
+};
+
+#endif //MESHGENERATOR_HPP
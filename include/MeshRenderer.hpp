@@ -61,5 +61,11 @@ private:
     GLuint normalbuffer;
     GLuint valencefieldbuffer;
     GLuint elementbuffer;
+
+    // type of the uploaded indices (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT)
+    GLenum elementtype;
+
+    // upload indices using the narrowest type able to address every vertex
+    void uploadIndices();
 };
 #endif
@@ -0,0 +1,63 @@
+#ifndef MESHSTREAM_HPP
+#define MESHSTREAM_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <functional>
+#include <cstdint>
+#include <glm.hpp>
+
+// MeshStream : sequential reader of a mesh too big to be loaded, block by block.
+// The vertices of the file are given first, then its triangles, in file order. The binary cache
+// of the OFF file is read when it is up to date (its checksum isn't verified, that would take a
+// pass over the whole cache), the OFF text otherwise, each block being parsed in parallel.
+// Memory only depends on the size of the blocks.
+class MeshStream {
+public:
+    // block of consecutive vertices or triangles : first is the id of the first one
+    typedef std::function<bool (size_t first, const std::vector<glm::vec3> & vertices)> VertexBlock;
+    typedef std::function<bool (size_t first, const std::vector<uint32_t> & indices)> TriangleBlock;
+
+    // @use_cache : read the binary cache stored next to the OFF file when it is up to date
+    // @block_bytes : bytes read from the file at once
+    MeshStream (const std::string & filename, bool use_cache, size_t block_bytes);
+
+    // false when the file can't be opened or its header is invalid, error() tells why
+    [[nodiscard]] bool valid () const { return m_error.empty(); }
+    [[nodiscard]] const std::string & error () const { return m_error; }
+
+    [[nodiscard]] size_t getNumberOfVertices () const { return m_nb_vertices; }
+    [[nodiscard]] size_t getNumberOfTriangles () const { return m_nb_triangles; }
+    [[nodiscard]] bool from_cache () const { return m_from_cache; }
+    [[nodiscard]] size_t block_bytes () const { return m_block_bytes; }
+
+    // read the whole mesh : vertices(first, block) for each block of vertices, then triangles(first, block)
+    // for each block of triangles (3 indices per triangle, checked against the number of vertices).
+    // Stops when a callback returns false. The stream can be read several times
+    bool read (const VertexBlock & vertices, const TriangleBlock & triangles);
+
+    // number of bytes held by the buffers of the stream at their peak
+    [[nodiscard]] size_t memory_usage () const { return m_peak_bytes; }
+
+private:
+    // header of the binary cache of filename : numbers of vertices and indices, and offsets of the
+    // vertex and index sections, false when the cache is missing, of another index type, outdated or corrupted
+    static bool open_cache (const std::string & filename, std::string & cache, size_t & nb_vertices, size_t & nb_indices,
+                            uint64_t & vertices_offset, uint64_t & indices_offset, uint32_t & index_size);
+
+    bool read_OFF (const VertexBlock & vertices, const TriangleBlock & triangles);
+    bool read_cache (const VertexBlock & vertices, const TriangleBlock & triangles);
+
+    std::string m_filename, m_cache;
+    std::string m_error;
+    size_t m_block_bytes;
+    size_t m_nb_vertices = 0, m_nb_triangles = 0;
+    bool m_from_cache = false;
+    // OFF : offset of the first record, cache : offsets of the vertex and index sections
+    uint64_t m_body_offset = 0, m_vertices_offset = 0, m_indices_offset = 0;
+    uint32_t m_index_size = 4;
+    size_t m_peak_bytes = 0;
+};
+
+#endif //MESHSTREAM_HPP
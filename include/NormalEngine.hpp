@@ -0,0 +1,206 @@
+#ifndef NORMALENGINE_HPP
+#define NORMALENGINE_HPP
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <glm.hpp>
+#include "Parallel.hpp"
+
+#if defined(__AVX__)
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define NORMALENGINE_SSE2
+#endif
+
+// weighting schemes of the triangle normals around a vertex, resolved at compile time
+struct UniformWeight {
+    static constexpr bool unit_faces = true;        // faces contribute their unit normal
+    static constexpr bool corner_angles = false;
+};
+struct AreaWeight {
+    static constexpr bool unit_faces = false;       // |cross product| is twice the area of the triangle
+    static constexpr bool corner_angles = false;
+};
+struct AngleWeight {
+    static constexpr bool unit_faces = true;
+    static constexpr bool corner_angles = true;     // unit normal times the angle of the triangle at the vertex
+};
+
+// NormalEngine : smooth vertex normals of an indexed triangle mesh.
+// Face normals are computed by batches of triangles in SIMD lanes (positions are gathered in
+// structure of arrays form), then each vertex gathers the normals of its triangles through the
+// vertex -> triangle adjacency, so vertices are processed in parallel without any race and the
+// sums don't depend on the number of threads.
+// Scratch buffers are kept between calls, they are not copied with the engine.
+class NormalEngine {
+public:
+    NormalEngine () = default;
+    NormalEngine (const NormalEngine &) {}
+    NormalEngine & operator= (const NormalEngine &) { return *this; }
+
+    // normals[v] : normalised weighted sum of the normals of the triangles around v, Adjacency gives
+    // the corners 3 * t + i of the triangles around v with corners_begin(v) and corners_end(v)
+    template <typename Weight, typename Index, typename Adjacency>
+    void compute (const std::vector<glm::vec3> & vertices, const std::vector<Index> & indices,
+                  const Adjacency & adjacency, std::vector<glm::vec3> & normals) {
+        const size_t nb_triangles = indices.size() / 3;
+        m_face_normals.resize(nb_triangles);
+        if (Weight::corner_angles) m_corner_weights.resize(indices.size());
+
+        parallel_for((nb_triangles + LANES - 1) / LANES, (1 << 12) / LANES, [&](size_t batch){
+            face_batch<Weight>(vertices, indices, batch * LANES, std::min(nb_triangles, (batch + 1) * LANES));
+        });
+
+        normals.resize(vertices.size());
+        parallel_for(vertices.size(), 1 << 12, [&](size_t v){
+            glm::vec3 normal(0.0f);
+            for (const unsigned int * corner = adjacency.corners_begin(v); corner != adjacency.corners_end(v); ++corner) {
+                if (Weight::corner_angles) normal += m_face_normals[*corner / 3] * m_corner_weights[*corner];
+                else normal += m_face_normals[*corner / 3];
+            }
+            // a vertex of degenerate triangles only has no normal
+            normals[v] = glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : normal;
+        });
+    }
+
+    // number of bytes held by the scratch buffers
+    [[nodiscard]] size_t memory_usage () const {
+        return m_face_normals.capacity() * sizeof(glm::vec3) + m_corner_weights.capacity() * sizeof(float);
+    }
+
+private:
+    // lanes of floats processed together, with the few operations used by the engine
+#if defined(__AVX__)
+    static constexpr size_t LANES = 8;
+    typedef __m256 Lane;
+    static Lane set1 (float f) { return _mm256_set1_ps(f); }
+    static Lane add (Lane a, Lane b) { return _mm256_add_ps(a, b); }
+    static Lane sub (Lane a, Lane b) { return _mm256_sub_ps(a, b); }
+    static Lane mul (Lane a, Lane b) { return _mm256_mul_ps(a, b); }
+    static Lane div (Lane a, Lane b) { return _mm256_div_ps(a, b); }
+    static Lane sqrt (Lane a) { return _mm256_sqrt_ps(a); }
+    static Lane min (Lane a, Lane b) { return _mm256_min_ps(a, b); }
+    static Lane max (Lane a, Lane b) { return _mm256_max_ps(a, b); }
+    // mask ? a : b, mask ? a : 0
+    static Lane select (Lane m, Lane a, Lane b) { return _mm256_blendv_ps(b, a, m); }
+    static Lane mask (Lane m, Lane a) { return _mm256_and_ps(m, a); }
+    static Lane less (Lane a, Lane b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static void store (float * p, Lane a) { _mm256_store_ps(p, a); }
+    template <int C> static Lane component (const glm::vec3 * v) {
+        return _mm256_set_ps(v[7][C], v[6][C], v[5][C], v[4][C], v[3][C], v[2][C], v[1][C], v[0][C]);
+    }
+#elif defined(NORMALENGINE_SSE2)
+    static constexpr size_t LANES = 4;
+    typedef __m128 Lane;
+    static Lane set1 (float f) { return _mm_set1_ps(f); }
+    static Lane add (Lane a, Lane b) { return _mm_add_ps(a, b); }
+    static Lane sub (Lane a, Lane b) { return _mm_sub_ps(a, b); }
+    static Lane mul (Lane a, Lane b) { return _mm_mul_ps(a, b); }
+    static Lane div (Lane a, Lane b) { return _mm_div_ps(a, b); }
+    static Lane sqrt (Lane a) { return _mm_sqrt_ps(a); }
+    static Lane min (Lane a, Lane b) { return _mm_min_ps(a, b); }
+    static Lane max (Lane a, Lane b) { return _mm_max_ps(a, b); }
+    static Lane select (Lane m, Lane a, Lane b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+    static Lane mask (Lane m, Lane a) { return _mm_and_ps(m, a); }
+    static Lane less (Lane a, Lane b) { return _mm_cmplt_ps(a, b); }
+    static void store (float * p, Lane a) { _mm_store_ps(p, a); }
+    template <int C> static Lane component (const glm::vec3 * v) { return _mm_set_ps(v[3][C], v[2][C], v[1][C], v[0][C]); }
+#else
+    static constexpr size_t LANES = 1;
+    typedef float Lane;
+    static Lane set1 (float f) { return f; }
+    static Lane add (Lane a, Lane b) { return a + b; }
+    static Lane sub (Lane a, Lane b) { return a - b; }
+    static Lane mul (Lane a, Lane b) { return a * b; }
+    static Lane div (Lane a, Lane b) { return a / b; }
+    static Lane sqrt (Lane a) { return std::sqrt(a); }
+    // NaN operands give b like the SIMD instructions
+    static Lane min (Lane a, Lane b) { return a < b ? a : b; }
+    static Lane max (Lane a, Lane b) { return a > b ? a : b; }
+    static Lane select (bool m, Lane a, Lane b) { return m ? a : b; }
+    static Lane mask (bool m, Lane a) { return m ? a : 0.0f; }
+    static bool less (Lane a, Lane b) { return a < b; }
+    static void store (float * p, Lane a) { *p = a; }
+    template <int C> static Lane component (const glm::vec3 * v) { return v[0][C]; }
+#endif
+
+    static Lane dot (Lane x1, Lane y1, Lane z1, Lane x2, Lane y2, Lane z2) {
+        return add(add(mul(x1, x2), mul(y1, y2)), mul(z1, z2));
+    }
+
+    // arc cosine of x in [-1, 1] : polynomial approximation of Abramowitz and Stegun 4.4.46 (error < 2e-8)
+    static Lane acos (Lane x) {
+        const auto negative = less(x, set1(0.0f));
+        const Lane a = max(x, sub(set1(0.0f), x));
+        Lane p = set1(-0.0012624911f);
+        p = add(mul(p, a), set1(0.0066700901f));
+        p = add(mul(p, a), set1(-0.0170881256f));
+        p = add(mul(p, a), set1(0.0308918810f));
+        p = add(mul(p, a), set1(-0.0501743046f));
+        p = add(mul(p, a), set1(0.0889789874f));
+        p = add(mul(p, a), set1(-0.2145988016f));
+        p = add(mul(p, a), set1(1.5707963050f));
+        const Lane r = mul(sqrt(sub(set1(1.0f), a)), p);
+        return select(negative, sub(set1(3.14159265f), r), r);
+    }
+
+    // face normals (and corner angles) of the triangles [begin, end), at most LANES triangles
+    template <typename Weight, typename Index>
+    void face_batch (const std::vector<glm::vec3> & vertices, const std::vector<Index> & indices, size_t begin, size_t end) {
+        // edges p1 - p0 and p2 - p0 of the triangles, unused lanes are zero
+        glm::vec3 e1[LANES], e2[LANES];
+        for (size_t l = 0; l < LANES; ++l) {
+            if (begin + l < end) {
+                const glm::vec3 p0 = vertices[indices[3 * (begin + l)]];
+                e1[l] = vertices[indices[3 * (begin + l) + 1]] - p0;
+                e2[l] = vertices[indices[3 * (begin + l) + 2]] - p0;
+            }
+            else e1[l] = e2[l] = glm::vec3(0.0f);
+        }
+        const Lane x1 = component<0>(e1), y1 = component<1>(e1), z1 = component<2>(e1);
+        const Lane x2 = component<0>(e2), y2 = component<1>(e2), z2 = component<2>(e2);
+
+        // cross products, normalised like glm::normalize : n * (1 / sqrt(n.n)). A zero-area triangle keeps
+        // its zero normal, masked like the degenerate corners below
+        Lane nx = sub(mul(y1, z2), mul(y2, z1));
+        Lane ny = sub(mul(z1, x2), mul(z2, x1));
+        Lane nz = sub(mul(x1, y2), mul(x2, y1));
+        if (Weight::unit_faces) {
+            const Lane length = sqrt(dot(nx, ny, nz, nx, ny, nz));
+            const Lane inverse = mask(less(set1(0.0f), length), div(set1(1.0f), length));
+            nx = mul(nx, inverse); ny = mul(ny, inverse); nz = mul(nz, inverse);
+        }
+        alignas(32) float n[3][LANES];
+        store(n[0], nx); store(n[1], ny); store(n[2], nz);
+        for (size_t t = begin; t < end; ++t) m_face_normals[t] = glm::vec3(n[0][t - begin], n[1][t - begin], n[2][t - begin]);
+
+        if (Weight::corner_angles) {
+            // angles between the edges at p0, p1 and p2, with the third edge p2 - p1 = e2 - e1
+            const Lane x3 = sub(x2, x1), y3 = sub(y2, y1), z3 = sub(z2, z1);
+            const Lane l1 = sqrt(dot(x1, y1, z1, x1, y1, z1));
+            const Lane l2 = sqrt(dot(x2, y2, z2, x2, y2, z2));
+            const Lane l3 = sqrt(dot(x3, y3, z3, x3, y3, z3));
+            const Lane cosines[3] = {div(dot(x1, y1, z1, x2, y2, z2), mul(l1, l2)),
+                                     div(sub(set1(0.0f), dot(x1, y1, z1, x3, y3, z3)), mul(l1, l3)),
+                                     div(dot(x2, y2, z2, x3, y3, z3), mul(l2, l3))};
+            const Lane lengths[3] = {mul(l1, l2), mul(l1, l3), mul(l2, l3)};
+
+            // clamped against rounding, a degenerate corner (NaN or infinite cosine) gets no weight
+            alignas(32) float angles[3][LANES];
+            for (int c = 0; c < 3; ++c) {
+                const auto valid = less(set1(0.0f), lengths[c]);
+                store(angles[c], mask(valid, acos(min(max(cosines[c], set1(-1.0f)), set1(1.0f)))));
+            }
+            for (size_t t = begin; t < end; ++t) {
+                for (int c = 0; c < 3; ++c) m_corner_weights[3 * t + c] = angles[c][t - begin];
+            }
+        }
+    }
+
+    std::vector<glm::vec3> m_face_normals;
+    std::vector<float> m_corner_weights;
+};
+
+#endif //NORMALENGINE_HPP
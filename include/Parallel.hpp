@@ -0,0 +1,93 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include "TaskPool.hpp"
+
+// split [0, n) in nb_chunks contiguous chunks and call f(chunk, begin, end) on each one : the chunks are
+// tasks of the shared TaskPool, the calling thread processes the first chunk then helps with the others.
+// No thread is created by the call, and a chunk may spawn parallel loops of its own
+template <typename F>
+void parallel_chunks(size_t n, unsigned int nb_chunks, F && f)
+{
+    if (n == 0) return;
+    if (nb_chunks > n) nb_chunks = (unsigned int) n;
+    if (nb_chunks < 1) nb_chunks = 1;
+    if (nb_chunks == 1) { f(0u, (size_t) 0, n); return; }
+
+    TaskPool & pool = TaskPool::instance();
+    TaskPool::Group group;
+    for (unsigned int c = 1; c < nb_chunks; ++c)
+    {
+        size_t begin = n * c / nb_chunks, end = n * (c + 1) / nb_chunks;
+        pool.run(group, [&f, c, begin, end](){ f(c, begin, end); });
+    }
+    f(0u, (size_t) 0, n / nb_chunks);
+    pool.wait(group);
+}
+
+// number of chunks used to process n elements in parallel, at least grain elements per chunk
+inline unsigned int parallel_nb_chunks(size_t n, size_t grain)
+{
+    return (unsigned int) std::min<size_t>(parallel_num_threads(), std::max<size_t>(n / std::max<size_t>(grain, 1), 1));
+}
+
+// call f(i) for each i in [0, n), in parallel when there are at least grain elements per thread
+template <typename F>
+void parallel_for(size_t n, size_t grain, F && f)
+{
+    parallel_chunks(n, parallel_nb_chunks(n, grain), [&f](unsigned int, size_t begin, size_t end){
+        for (size_t i = begin; i < end; ++i) f(i);
+    });
+}
+
+// stable sort of the (keys[i], values[i]) pairs on the key_bits lowest bits of the keys :
+// least significant digit radix sort on 8-bit digits, each pass is done in parallel and
+// the result doesn't depend on the number of threads
+template <typename Value>
+void parallel_radix_sort(std::vector<uint64_t> & keys, std::vector<Value> & values, unsigned int key_bits)
+{
+    const size_t n = keys.size();
+    const unsigned int nb_chunks = parallel_nb_chunks(n, 1 << 16);
+    std::vector<uint64_t> sorted_keys(n);
+    std::vector<Value> sorted_values(n);
+    std::vector<size_t> offsets(256 * (size_t) nb_chunks);
+
+    for (unsigned int shift = 0; shift < key_bits; shift += 8)
+    {
+        // histogram of the digits of each chunk
+        std::fill(offsets.begin(), offsets.end(), 0);
+        parallel_chunks(n, nb_chunks, [&](unsigned int c, size_t begin, size_t end){
+            size_t * histogram = &offsets[256 * (size_t) c];
+            for (size_t i = begin; i < end; ++i) histogram[(keys[i] >> shift) & 0xFF]++;
+        });
+
+        // digit-major, chunk-minor prefix sum keeps equal digits in their input order
+        size_t sum = 0;
+        for (unsigned int digit = 0; digit < 256; ++digit)
+        {
+            for (unsigned int c = 0; c < nb_chunks; ++c)
+            {
+                size_t count = offsets[256 * (size_t) c + digit];
+                offsets[256 * (size_t) c + digit] = sum;
+                sum += count;
+            }
+        }
+
+        parallel_chunks(n, nb_chunks, [&](unsigned int c, size_t begin, size_t end){
+            size_t * offset = &offsets[256 * (size_t) c];
+            for (size_t i = begin; i < end; ++i)
+            {
+                size_t position = offset[(keys[i] >> shift) & 0xFF]++;
+                sorted_keys[position] = keys[i];
+                sorted_values[position] = values[i];
+            }
+        });
+        keys.swap(sorted_keys);
+        values.swap(sorted_values);
+    }
+}
+
+#endif //PARALLEL_HPP
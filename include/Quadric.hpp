@@ -0,0 +1,116 @@
+#ifndef QUADRIC_HPP
+#define QUADRIC_HPP
+
+#include <cmath>
+#include <glm.hpp>
+
+#if defined(__AVX__)
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define QUADRIC_SSE2
+#endif
+
+// Quadric : symmetric 4x4 matrix Q of the quadric error v^T Q v of a point v = (x, y, z, 1),
+// stored as its 10 distinct coefficients (padded to 12 for SIMD accumulation) :
+//
+//      | a2 ab ac ad |
+//  Q = | ab b2 bc bd |     m_q = a2 ab ac ad b2 bc bd c2 cd d2 0 0
+//      | ac bc c2 cd |
+//      | ad bd cd d2 |
+//
+// Coefficients are doubles : sums of many plane quadrics lose too much precision in float.
+class Quadric {
+public:
+    Quadric () {
+        for (double & q : m_q) q = 0.0;
+    }
+
+    // quadric of the squared distance to the plane ax + by + cz + d = 0
+    // (scaled by a^2 + b^2 + c^2 when the plane isn't normalised)
+    Quadric (double a, double b, double c, double d) {
+        m_q[0] = a * a; m_q[1] = a * b; m_q[2] = a * c; m_q[3] = a * d;
+        m_q[4] = b * b; m_q[5] = b * c; m_q[6] = b * d;
+        m_q[7] = c * c; m_q[8] = c * d;
+        m_q[9] = d * d;
+        m_q[10] = m_q[11] = 0.0;
+    }
+
+    explicit Quadric (glm::vec4 plane) : Quadric(plane.x, plane.y, plane.z, plane.w) {}
+
+    Quadric & operator+= (const Quadric & other) {
+#if defined(__AVX__)
+        for (int i = 0; i < 12; i += 4) _mm256_store_pd(m_q + i, _mm256_add_pd(_mm256_load_pd(m_q + i), _mm256_load_pd(other.m_q + i)));
+#elif defined(QUADRIC_SSE2)
+        for (int i = 0; i < 12; i += 2) _mm_store_pd(m_q + i, _mm_add_pd(_mm_load_pd(m_q + i), _mm_load_pd(other.m_q + i)));
+#else
+        for (int i = 0; i < 12; ++i) m_q[i] += other.m_q[i];
+#endif
+        return *this;
+    }
+
+    Quadric & operator*= (double s) {
+#if defined(__AVX__)
+        const __m256d factor = _mm256_set1_pd(s);
+        for (int i = 0; i < 12; i += 4) _mm256_store_pd(m_q + i, _mm256_mul_pd(_mm256_load_pd(m_q + i), factor));
+#elif defined(QUADRIC_SSE2)
+        const __m128d factor = _mm_set1_pd(s);
+        for (int i = 0; i < 12; i += 2) _mm_store_pd(m_q + i, _mm_mul_pd(_mm_load_pd(m_q + i), factor));
+#else
+        for (int i = 0; i < 12; ++i) m_q[i] *= s;
+#endif
+        return *this;
+    }
+
+    Quadric operator+ (const Quadric & other) const { Quadric q = *this; q += other; return q; }
+    Quadric operator* (double s) const { Quadric q = *this; q *= s; return q; }
+
+    // quadric error v^T Q v at p
+    [[nodiscard]] double evaluate (glm::vec3 p) const {
+        const double x = p.x, y = p.y, z = p.z;
+        return x * (m_q[0] * x + 2.0 * (m_q[1] * y + m_q[2] * z + m_q[3]))
+             + y * (m_q[4] * y + 2.0 * (m_q[5] * z + m_q[6]))
+             + z * (m_q[7] * z + 2.0 * m_q[8])
+             + m_q[9];
+    }
+
+    // point minimising the error : solution of A p = -b with A the upper-left 3x3 block of Q
+    // and b its last column. A is symmetric positive semi-definite, it is factored as L D L^T and
+    // the minimum is rejected (false) when a pivot is negligible against the trace of A, that is
+    // when the triangles are (nearly) parallel and the minimum is a line or a plane
+    bool minimise (glm::vec3 & p) const {
+        const double a00 = m_q[0], a01 = m_q[1], a02 = m_q[2], a11 = m_q[4], a12 = m_q[5], a22 = m_q[7];
+        const double epsilon = 1e-6 * (a00 + a11 + a22);
+        if (!(epsilon > 0.0)) return false;
+
+        // L D L^T factorisation
+        const double d0 = a00;
+        if (d0 <= epsilon) return false;
+        const double l10 = a01 / d0, l20 = a02 / d0;
+        const double d1 = a11 - l10 * a01;
+        if (d1 <= epsilon) return false;
+        const double l21 = (a12 - l20 * a01) / d1;
+        const double d2 = a22 - l20 * a02 - l21 * l21 * d1;
+        if (d2 <= epsilon) return false;
+
+        // forward substitution, diagonal, backward substitution
+        const double y0 = -m_q[3];
+        const double y1 = -m_q[6] - l10 * y0;
+        const double y2 = -m_q[8] - l20 * y0 - l21 * y1;
+        const double z = y2 / d2;
+        const double y = y1 / d1 - l21 * z;
+        const double x = y0 / d0 - l10 * y - l20 * z;
+        if (!std::isfinite(x) || !std::isfinite(y) || !std::isfinite(z)) return false;
+
+        p = glm::vec3((float) x, (float) y, (float) z);
+        return true;
+    }
+
+    // coefficient i of a2 ab ac ad b2 bc bd c2 cd d2
+    [[nodiscard]] double operator[] (int i) const { return m_q[i]; }
+
+private:
+    alignas(32) double m_q[12];
+};
+
+#endif //QUADRIC_HPP
@@ -0,0 +1,109 @@
+#ifndef SPARSEGRID_HPP
+#define SPARSEGRID_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+
+// SparseGrid : cells of a regular grid stored in an open-addressing hash table
+// (linear probing) keyed on the packed cell coordinates. Cells get consecutive ids
+// in insertion order, so memory only depends on the number of occupied cells.
+class SparseGrid {
+public:
+    static constexpr unsigned int NOT_FOUND = std::numeric_limits<unsigned int>::max();
+    // coordinates are packed on 21 bits each
+    static constexpr unsigned int MAX_RESOLUTION = 1u << 21;
+
+    explicit SparseGrid (size_t expected_cells = 0) {
+        size_t capacity = 16;
+        while (capacity < 2 * expected_cells) capacity *= 2;
+        m_slots.assign(capacity, Slot());
+    }
+
+    // key of the cell (ix, iy, iz), keys are ordered like ix + iy * res + iz * res^2
+    static uint64_t pack (unsigned int ix, unsigned int iy, unsigned int iz) {
+        return ((uint64_t) iz << 42) | ((uint64_t) iy << 21) | (uint64_t) ix;
+    }
+
+    // Morton key of the cell (ix, iy, iz), bits interleaved as ... z1 y1 x1 z0 y0 x0 : the key of the cell
+    // containing it in the grid of half the resolution is key >> 3
+    static uint64_t morton (unsigned int ix, unsigned int iy, unsigned int iz) {
+        return spread(ix) | (spread(iy) << 1) | (spread(iz) << 2);
+    }
+
+    // id of the cell with the given key, the cell is created if needed
+    unsigned int insert (uint64_t key) {
+        if (2 * (m_keys.size() + 1) > m_slots.size()) grow();
+        size_t mask = m_slots.size() - 1;
+        for (size_t s = hash(key) & mask; ; s = (s + 1) & mask) {
+            if (m_slots[s].id == NOT_FOUND) {
+                m_slots[s].key = key;
+                m_slots[s].id = (unsigned int) m_keys.size();
+                m_keys.push_back(key);
+                return m_slots[s].id;
+            }
+            if (m_slots[s].key == key) return m_slots[s].id;
+        }
+    }
+
+    // id of the cell with the given key, NOT_FOUND if the cell is empty
+    [[nodiscard]] unsigned int find (uint64_t key) const {
+        size_t mask = m_slots.size() - 1;
+        for (size_t s = hash(key) & mask; ; s = (s + 1) & mask) {
+            if (m_slots[s].id == NOT_FOUND) return NOT_FOUND;
+            if (m_slots[s].key == key) return m_slots[s].id;
+        }
+    }
+
+    // number of occupied cells
+    [[nodiscard]] size_t size () const { return m_keys.size(); }
+
+    // key of each occupied cell, indexed by cell id
+    [[nodiscard]] const std::vector<uint64_t> & keys () const { return m_keys; }
+
+    // number of bytes held by the table
+    [[nodiscard]] size_t memory_usage () const {
+        return m_slots.capacity() * sizeof(Slot) + m_keys.capacity() * sizeof(uint64_t);
+    }
+
+private:
+    // 21 bits of x spread to every third bit
+    static uint64_t spread (uint64_t x) {
+        x &= 0x1fffff;
+        x = (x | (x << 32)) & 0x1f00000000ffffull;
+        x = (x | (x << 16)) & 0x1f0000ff0000ffull;
+        x = (x | (x << 8)) & 0x100f00f00f00f00full;
+        x = (x | (x << 4)) & 0x10c30c30c30c30c3ull;
+        x = (x | (x << 2)) & 0x1249249249249249ull;
+        return x;
+    }
+
+    struct Slot {
+        uint64_t key = 0;
+        unsigned int id = NOT_FOUND;
+    };
+
+    static size_t hash (uint64_t key) {
+        key ^= key >> 31;
+        key *= 0x9E3779B97F4A7C15ull;
+        return (size_t) (key ^ (key >> 29));
+    }
+
+    void grow () {
+        std::vector<Slot> old_slots(2 * m_slots.size(), Slot());
+        old_slots.swap(m_slots);
+        size_t mask = m_slots.size() - 1;
+        for (const Slot & slot : old_slots) {
+            if (slot.id == NOT_FOUND) continue;
+            size_t s = hash(slot.key) & mask;
+            while (m_slots[s].id != NOT_FOUND) s = (s + 1) & mask;
+            m_slots[s] = slot;
+        }
+    }
+
+    std::vector<Slot> m_slots;
+    std::vector<uint64_t> m_keys;
+};
+
+#endif //SPARSEGRID_HPP
@@ -0,0 +1,165 @@
+#ifndef TASKPOOL_HPP
+#define TASKPOOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// number of threads used by parallel loops :
+// MESH_NUM_THREADS environment variable if set, hardware concurrency otherwise
+inline unsigned int parallel_num_threads()
+{
+    static const unsigned int num_threads = [](){
+        const char * env = std::getenv("MESH_NUM_THREADS");
+        int n = env ? std::atoi(env) : 0;
+        if (n <= 0) n = (int) std::thread::hardware_concurrency();
+        return (unsigned int) std::max(n, 1);
+    }();
+    return num_threads;
+}
+
+// TaskPool : work-stealing pool for recursive tasks.
+// Each worker has its own deque : it pushes and pops tasks at the back (depth first, cache friendly)
+// while idle workers steal the oldest tasks, usually the biggest ones, at the front of the others.
+// A thread waiting for a group of tasks runs tasks too, so tasks can spawn and wait for sub-tasks.
+class TaskPool {
+public:
+    // tasks spawned together, wait() returns when all of them are done
+    class Group {
+        friend class TaskPool;
+        std::atomic<size_t> m_pending{0};
+    };
+
+    // pool shared by the program, with parallel_num_threads() - 1 workers next to the calling thread
+    static TaskPool & instance () {
+        static TaskPool pool(parallel_num_threads() - 1);
+        return pool;
+    }
+
+    explicit TaskPool (unsigned int nb_workers) {
+        // queue 0 is shared by the threads outside of the pool
+        for (unsigned int q = 0; q <= nb_workers; ++q) m_queues.emplace_back(new Queue());
+        for (unsigned int w = 1; w <= nb_workers; ++w) m_threads.emplace_back([this, w](){ work(w); });
+    }
+
+    ~TaskPool () {
+        {
+            std::lock_guard<std::mutex> lock(m_sleep_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto & thread : m_threads) thread.join();
+    }
+
+    TaskPool (const TaskPool &) = delete;
+    TaskPool & operator= (const TaskPool &) = delete;
+
+    [[nodiscard]] unsigned int nb_workers () const { return (unsigned int) m_threads.size(); }
+
+    // run task in the pool as part of group, directly when the pool has no worker
+    void run (Group & group, std::function<void()> task) {
+        if (m_threads.empty()) { task(); return; }
+
+        group.m_pending++;
+        m_queued++;
+        Queue & queue = *m_queues[queue_index()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(Task{std::move(task), &group});
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        }
+        m_wake.notify_one();
+    }
+
+    // run tasks until all the tasks of group are done
+    void wait (Group & group) {
+        const unsigned int self = queue_index();
+        while (group.m_pending.load() > 0) {
+            if (!run_one(self)) std::this_thread::yield();
+        }
+    }
+
+private:
+    struct Task {
+        std::function<void()> function;
+        Group * group;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // queue of the calling thread : its own one for a worker of this pool, the shared one otherwise
+    unsigned int queue_index () const {
+        return t_pool == this ? t_queue : 0;
+    }
+
+    // pop a task of the queue self, or steal one from the other queues, and run it
+    bool run_one (unsigned int self) {
+        Task task;
+        bool found = false;
+        {
+            Queue & queue = *m_queues[self];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) { task = std::move(queue.tasks.back()); queue.tasks.pop_back(); found = true; }
+        }
+        for (size_t i = 1; !found && i < m_queues.size(); ++i) {
+            Queue & queue = *m_queues[(self + i) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) { task = std::move(queue.tasks.front()); queue.tasks.pop_front(); found = true; }
+        }
+        if (!found) return false;
+
+        m_queued--;
+        task.function();
+        task.group->m_pending--;
+        return true;
+    }
+
+    void work (unsigned int self) {
+        t_pool = this;
+        t_queue = self;
+        for (;;) {
+            if (run_one(self)) continue;
+            std::unique_lock<std::mutex> lock(m_sleep_mutex);
+            m_wake.wait(lock, [this](){ return m_stop || m_queued.load() > 0; });
+            if (m_stop) return;
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::atomic<size_t> m_queued{0};
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+
+    static inline thread_local const TaskPool * t_pool = nullptr;
+    static inline thread_local unsigned int t_queue = 0;
+};
+
+// call f(i) for each i in [0, n) with tasks of grain elements on the shared pool
+template <typename F>
+void task_parallel_for(size_t n, size_t grain, F && f)
+{
+    TaskPool & pool = TaskPool::instance();
+    TaskPool::Group group;
+    grain = std::max<size_t>(grain, 1);
+    for (size_t begin = 0; begin < n; begin += grain) {
+        size_t end = std::min(n, begin + grain);
+        pool.run(group, [&f, begin, end](){ for (size_t i = begin; i < end; ++i) f(i); });
+    }
+    pool.wait(group);
+}
+
+#endif //TASKPOOL_HPP
@@ -0,0 +1,64 @@
+#ifndef TEXTPARSING_HPP
+#define TEXTPARSING_HPP
+
+#include <charconv>
+#include <cstring>
+
+// locale-free helpers to read and write the records of OFF text files,
+// p is the current position and end the end of the text
+
+inline bool is_blank(char c) {return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';}
+
+// skip blanks on the current line
+inline const char * skip_blanks(const char * p, const char * end)
+{
+    while (p < end && is_blank(*p)) ++p;
+    return p;
+}
+
+// skip blanks, new lines and comments
+inline const char * skip_spaces(const char * p, const char * end)
+{
+    while (p < end)
+    {
+        if (is_blank(*p) || *p == '\n') ++p;
+        else if (*p == '#') { while (p < end && *p != '\n') ++p; }
+        else break;
+    }
+    return p;
+}
+
+// move to the first character of the next line
+inline const char * next_line(const char * p, const char * end)
+{
+    const char * nl = (const char *) std::memchr(p, '\n', end - p);
+    return nl ? nl + 1 : end;
+}
+
+// a record is a line holding a vertex or a face : not empty and not a comment
+inline bool is_record(const char * p, const char * end)
+{
+    p = skip_blanks(p, end);
+    return p < end && *p != '\n' && *p != '#';
+}
+
+// parse the number following the blanks at p, nullptr if there is none
+template <typename T>
+inline const char * parse_number(const char * p, const char * end, T & value)
+{
+    p = skip_blanks(p, end);
+    if (p < end && *p == '+') ++p;
+    std::from_chars_result result = std::from_chars(p, end, value);
+    return result.ec == std::errc() ? result.ptr : nullptr;
+}
+
+// append the shortest text reading back as value, then separator
+template <typename T>
+inline char * format_number(char * p, char * end, T value, char separator)
+{
+    p = std::to_chars(p, end, value).ptr;
+    *p++ = separator;
+    return p;
+}
+
+#endif //TEXTPARSING_HPP
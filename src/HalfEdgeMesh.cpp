@@ -0,0 +1,287 @@
+#include "HalfEdgeMesh.hpp"
+#include "Mesh.hpp"
+#include "Parallel.hpp"
+
+#include <atomic>
+#include <memory>
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// construction
+//
+// start : 0 6 12 ...                half-edges of the edges whose smaller vertex is v : edges[start[v]] ... edges[start[v + 1] - 1]
+// edges : (4, 0) (4, 7) (9, 5) ...  as (larger vertex, half-edge), sorted : the half-edges of an edge are side by side
+HalfEdgeMesh::HalfEdgeMesh (const Mesh & mesh)
+    : m_positions(mesh.indexed_vertices)
+{
+    const std::vector<mesh_index> & indices = mesh.indices;
+    const unsigned int nb_vertices = (unsigned int) m_positions.size();
+    const size_t nb_halfedges = indices.size();
+
+    m_origin.resize(nb_halfedges);
+    m_twin.assign(nb_halfedges, NONE);
+    parallel_for(nb_halfedges, 1 << 14, [&](size_t h){ m_origin[h] = indices[h]; });
+    m_face_removed.assign(nb_halfedges / 3, 0);
+    m_nb_remaining_faces = (unsigned int) (nb_halfedges / 3);
+
+    // counting sort of the half-edges on the smaller vertex of their edge (the first digit of a radix sort of
+    // the edge keys), then the short list of each vertex is sorted on the larger vertex. On several threads
+    // the slots of each vertex are taken in any order, the sort gives the same lists
+    auto low = [&](size_t h){ return std::min(m_origin[h], m_origin[next((unsigned int) h)]); };
+    auto entry = [&](size_t h){ return ((uint64_t) std::max(m_origin[h], m_origin[next((unsigned int) h)]) << 32) | h; };
+    const bool serial = parallel_nb_chunks(nb_halfedges, 1 << 16) == 1;
+    std::unique_ptr<std::atomic<unsigned int>[]> slot(new std::atomic<unsigned int>[nb_vertices]);
+    std::vector<unsigned int> start(nb_vertices + 1);
+    std::unique_ptr<uint64_t[]> edges(new uint64_t[nb_halfedges]);
+    start[0] = 0;
+    if (serial) {
+        std::vector<unsigned int> counts(nb_vertices, 0);
+        for (size_t h = 0; h < nb_halfedges; ++h) counts[low(h)]++;
+        for (unsigned int v = 0; v < nb_vertices; ++v) start[v + 1] = start[v] + counts[v];
+        std::copy(start.begin(), start.end() - 1, counts.begin());
+        for (size_t h = 0; h < nb_halfedges; ++h) edges[counts[low(h)]++] = entry(h);
+    }
+    else {
+        parallel_for(nb_vertices, 1 << 14, [&](size_t v){ slot[v].store(0, std::memory_order_relaxed); });
+        parallel_for(nb_halfedges, 1 << 14, [&](size_t h){ slot[low(h)].fetch_add(1, std::memory_order_relaxed); });
+        for (unsigned int v = 0; v < nb_vertices; ++v) start[v + 1] = start[v] + slot[v].load(std::memory_order_relaxed);
+
+        parallel_for(nb_vertices, 1 << 14, [&](size_t v){ slot[v].store(start[v], std::memory_order_relaxed); });
+        parallel_for(nb_halfedges, 1 << 14, [&](size_t h){ edges[slot[low(h)].fetch_add(1, std::memory_order_relaxed)] = entry(h); });
+    }
+    parallel_for(nb_vertices, 1 << 12, [&](size_t v){ std::sort(edges.get() + start[v], edges.get() + start[v + 1]); });
+
+    // the two half-edges of an edge are twins when they go in opposite directions in two faces
+    // and the edge has no other half-edge
+    parallel_for(nb_vertices, 1 << 12, [&](size_t v){
+        for (unsigned int i = start[v], j; i < start[v + 1]; i = j) {
+            for (j = i + 1; j < start[v + 1] && (edges[j] >> 32) == (edges[i] >> 32); ++j) {}
+            if (j != i + 2) continue;
+            const unsigned int h = (unsigned int) edges[i], twin = (unsigned int) edges[i + 1];
+            if (m_origin[h] == m_origin[twin] || face(h) == face(twin)) continue;
+            m_twin[h] = twin;
+            m_twin[twin] = h;
+        }
+    });
+
+    // outgoing half-edge of each vertex : the smallest one without twin, the smallest one when there is none,
+    // and the number of half-edges leaving each vertex
+    m_outgoing.assign(nb_vertices, NONE);
+    m_nb_outgoing.assign(nb_vertices, 0);
+    if (serial) {
+        // in increasing order, only a first half-edge without twin replaces the first half-edge
+        for (unsigned int h = 0; h < nb_halfedges; ++h) {
+            const unsigned int v = m_origin[h];
+            m_nb_outgoing[v]++;
+            if (m_outgoing[v] == NONE || (m_twin[h] == NONE && m_twin[m_outgoing[v]] != NONE)) m_outgoing[v] = h;
+        }
+    }
+    else {
+        std::unique_ptr<std::atomic<uint64_t>[]> first(new std::atomic<uint64_t>[nb_vertices]);
+        parallel_for(nb_vertices, 1 << 14, [&](size_t v){
+            first[v].store(UINT64_MAX, std::memory_order_relaxed);
+            slot[v].store(0, std::memory_order_relaxed);
+        });
+        parallel_for(nb_halfedges, 1 << 14, [&](size_t h){
+            const uint64_t key = ((uint64_t) (m_twin[h] != NONE) << 32) | h;
+            std::atomic<uint64_t> & current = first[m_origin[h]];
+            uint64_t previous = current.load(std::memory_order_relaxed);
+            while (key < previous && !current.compare_exchange_weak(previous, key, std::memory_order_relaxed)) {}
+            slot[m_origin[h]].fetch_add(1, std::memory_order_relaxed);
+        });
+        parallel_for(nb_vertices, 1 << 14, [&](size_t v){
+            const uint64_t key = first[v].load(std::memory_order_relaxed);
+            if (key != UINT64_MAX) m_outgoing[v] = (unsigned int) key;
+            m_nb_outgoing[v] = slot[v].load(std::memory_order_relaxed);
+        });
+    }
+}
+
+void HalfEdgeMesh::to_mesh (Mesh & mesh) const
+{
+    std::vector<unsigned int> vertex_ids, face_ids;
+    const unsigned int nb_kept = remaining(vertex_ids, face_ids);
+
+    // a fresh mesh : nothing computed for the previous triangles is kept
+    mesh = Mesh();
+    mesh.indexed_vertices.resize(nb_kept);
+    parallel_for(vertex_ids.size(), 1 << 14, [&](size_t v){
+        if (vertex_ids[v] != NONE) mesh.indexed_vertices[vertex_ids[v]] = m_positions[v];
+    });
+    mesh.indices.resize(3 * (size_t) m_nb_remaining_faces);
+    parallel_for(face_ids.size(), 1 << 14, [&](size_t f){
+        if (m_face_removed[f]) return;
+        for (short i = 0; i < 3; ++i) mesh.indices[3 * (size_t) face_ids[f] + i] = (mesh_index) vertex_ids[m_origin[3 * f + i]];
+    });
+
+    glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+    for (const glm::vec3 & p : mesh.indexed_vertices) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    if (nb_kept > 0) {
+        mesh.bounding_box.xpos = glm::vec2(min.x, max.x);
+        mesh.bounding_box.ypos = glm::vec2(min.y, max.y);
+        mesh.bounding_box.zpos = glm::vec2(min.z, max.z);
+    }
+    mesh.indexed_uvs.resize(nb_kept, glm::vec2(1.));
+    mesh.compute_smooth_vertex_normals<UniformWeight>();
+}
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// collapses
+//
+//            c                                c
+//          /   ^                              |
+//      p  /     \  n        collapse(h)       |  twin(p) and twin(n) become twins
+//        v   f   \             --->           |
+//       a -------> b                          b
+//        \   g   /                            |
+//         v     /                             |  twin(next(g)) and twin(prev(g)) become twins
+//            d                                d
+bool HalfEdgeMesh::can_collapse (unsigned int h, Scratch & scratch) const
+{
+    if (m_face_removed[face(h)]) return false;
+    const unsigned int a = origin(h), b = target(h);
+    if (a == b || !is_single_fan(a) || !is_single_fan(b)) return false;
+    if (!is_border(h) && is_border_vertex(a) && is_border_vertex(b)) return false;
+
+    std::vector<unsigned int> & ring_a = scratch.ring, & ring_b = scratch.other_ring;
+    gather_ring(a, ring_a);
+    gather_ring(b, ring_b);
+    // common neighbours, and neighbours of either end other than a and b
+    unsigned int nb_common = 0, nb_others = 0;
+    for (size_t i = 0, j = 0; i < ring_a.size() || j < ring_b.size();) {
+        unsigned int n;
+        if (j == ring_b.size() || (i < ring_a.size() && ring_a[i] < ring_b[j])) n = ring_a[i++];
+        else if (i == ring_a.size() || ring_b[j] < ring_a[i]) n = ring_b[j++];
+        else n = ring_a[i], ++nb_common, ++i, ++j;
+        if (n != a && n != b) ++nb_others;
+    }
+    return nb_common == (is_border(h) ? 1u : 2u) && nb_others > nb_common;
+}
+
+void HalfEdgeMesh::collapse (unsigned int h, glm::vec3 position)
+{
+    const unsigned int a = origin(h), b = target(h), g = m_twin[h];
+    const unsigned int n = next(h), p = prev(h), c = origin(p);
+    const unsigned int twin_n = m_twin[n], twin_p = m_twin[p];
+    const unsigned int next_g = g == NONE ? NONE : next(g), prev_g = g == NONE ? NONE : prev(g);
+    const unsigned int d = g == NONE ? NONE : origin(prev_g);
+    const unsigned int twin_next_g = g == NONE ? NONE : m_twin[next_g], twin_prev_g = g == NONE ? NONE : m_twin[prev_g];
+    const unsigned int outgoing_a = m_outgoing[a], outgoing_b = m_outgoing[b];
+
+    // every half-edge leaving a leaves b, the two other edges of each removed face become one
+    for_each_outgoing(a, [&](unsigned int k){ m_origin[k] = b; });
+    if (twin_n != NONE) m_twin[twin_n] = twin_p;
+    if (twin_p != NONE) m_twin[twin_p] = twin_n;
+    m_face_removed[face(h)] = 1;
+    --m_nb_remaining_faces;
+    if (g != NONE) {
+        if (twin_next_g != NONE) m_twin[twin_next_g] = twin_prev_g;
+        if (twin_prev_g != NONE) m_twin[twin_prev_g] = twin_next_g;
+        m_face_removed[face(g)] = 1;
+        --m_nb_remaining_faces;
+    }
+
+    m_positions[b] = position;
+    m_outgoing[a] = NONE;
+    m_nb_outgoing[b] += m_nb_outgoing[a] - (g == NONE ? 2 : 4);
+    m_nb_outgoing[a] = 0;
+    m_nb_outgoing[c]--;
+    if (d != NONE) m_nb_outgoing[d]--;
+    auto after = [&](unsigned int k){ return k == NONE ? NONE : next(k); };
+    reset_outgoing(b, {twin_p, twin_prev_g, after(twin_n), after(twin_next_g), outgoing_b, outgoing_a});
+    reset_outgoing(c, {twin_n, after(twin_p)});
+    if (d != NONE) reset_outgoing(d, {twin_next_g, after(twin_prev_g)});
+}
+
+bool HalfEdgeMesh::is_single_fan (unsigned int v) const
+{
+    unsigned int nb_fan = 0;
+    for_each_outgoing(v, [&](unsigned int){ ++nb_fan; });
+    return nb_fan == m_nb_outgoing[v];
+}
+
+void HalfEdgeMesh::reset_outgoing (unsigned int v, std::initializer_list<unsigned int> candidates)
+{
+    unsigned int outgoing = NONE;
+    for (unsigned int k : candidates) {
+        if (k == NONE || m_face_removed[face(k)] || m_origin[k] != v) continue;
+        outgoing = k;
+        break;
+    }
+    // back to the half-edge without twin, if any : next(twin(k)) is the half-edge before k around v
+    if (outgoing != NONE) {
+        unsigned int k = outgoing;
+        while (m_twin[k] != NONE && next(m_twin[k]) != outgoing) k = next(m_twin[k]);
+        if (m_twin[k] == NONE) outgoing = k;
+    }
+    m_outgoing[v] = outgoing;
+}
+
+void HalfEdgeMesh::gather_ring (unsigned int v, std::vector<unsigned int> & ring) const
+{
+    ring.clear();
+    for_each_outgoing(v, [&](unsigned int k){
+        ring.push_back(target(k));
+        ring.push_back(m_origin[prev(k)]);
+    });
+    std::sort(ring.begin(), ring.end());
+    ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+}
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// compaction
+unsigned int HalfEdgeMesh::remaining (std::vector<unsigned int> & vertex_ids, std::vector<unsigned int> & face_ids) const
+{
+    vertex_ids.assign(m_positions.size(), NONE);
+    face_ids.resize(m_face_removed.size());
+    unsigned int nb_faces = 0;
+    for (size_t f = 0; f < m_face_removed.size(); ++f) face_ids[f] = m_face_removed[f] ? NONE : nb_faces++;
+    parallel_for(m_face_removed.size(), 1 << 14, [&](size_t f){
+        if (m_face_removed[f]) return;
+        for (short i = 0; i < 3; ++i) vertex_ids[m_origin[3 * f + i]] = 0;
+    });
+    unsigned int nb_vertices = 0;
+    for (unsigned int & id : vertex_ids) if (id != NONE) id = nb_vertices++;
+    return nb_vertices;
+}
+
+void HalfEdgeMesh::compact ()
+{
+    std::vector<unsigned int> vertex_ids, face_ids;
+    const unsigned int nb_kept = remaining(vertex_ids, face_ids);
+    auto halfedge_id = [&](unsigned int h){ return h == NONE ? NONE : 3 * face_ids[face(h)] + h % 3; };
+
+    std::vector<glm::vec3> positions(nb_kept);
+    std::vector<unsigned int> outgoing(nb_kept);
+    std::vector<unsigned int> nb_outgoing(nb_kept);
+    parallel_for(vertex_ids.size(), 1 << 14, [&](size_t v){
+        if (vertex_ids[v] == NONE) return;
+        positions[vertex_ids[v]] = m_positions[v];
+        outgoing[vertex_ids[v]] = halfedge_id(m_outgoing[v]);
+        nb_outgoing[vertex_ids[v]] = m_nb_outgoing[v];
+    });
+
+    std::vector<unsigned int> origin(3 * (size_t) m_nb_remaining_faces), twin(3 * (size_t) m_nb_remaining_faces);
+    parallel_for(face_ids.size(), 1 << 14, [&](size_t f){
+        if (m_face_removed[f]) return;
+        for (unsigned int i = 0; i < 3; ++i) {
+            origin[3 * (size_t) face_ids[f] + i] = vertex_ids[m_origin[3 * f + i]];
+            twin[3 * (size_t) face_ids[f] + i] = halfedge_id(m_twin[3 * f + i]);
+        }
+    });
+
+    m_positions.swap(positions);
+    m_outgoing.swap(outgoing);
+    m_nb_outgoing.swap(nb_outgoing);
+    m_origin.swap(origin);
+    m_twin.swap(twin);
+    m_face_removed.assign(m_nb_remaining_faces, 0);
+}
@@ -1,4 +1,14 @@
 #include "Mesh.hpp"
+#include "SparseGrid.hpp"
+#include "Parallel.hpp"
+#include "MeshStream.hpp"
+#include "MappedFile.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
 
 // ******************************************************************************************************
 // ******************************************************************************************************
@@ -6,17 +16,24 @@
 // constructors
 Mesh::Mesh()= default;
 
-Mesh::Mesh(const char * filename)
+Mesh::Mesh(const char * filename, bool use_cache)
 {
     bounding_box = BOX();
 
-    load_OFF_file(filename, indexed_vertices, indexed_normals, indices, triangles,
-                  bounding_box.xpos, bounding_box.ypos, bounding_box.zpos);
+    if (!use_cache || !load_cache_file(filename))
+    {
+        if (load_OFF_file(filename, indexed_vertices, indexed_normals, indices,
+                          bounding_box.xpos, bounding_box.ypos, bounding_box.zpos) && use_cache)
+        {
+            write_cache_file(filename);
+        }
+    }
     std::cout << "**********\nBounding box :" << std::endl;
     std::cout << "(xmin, xmax) = (" << bounding_box.xpos.x << ", " << bounding_box.xpos.y << ")" << std::endl;
     std::cout << "(ymin, ymax) = (" << bounding_box.ypos.x << ", " << bounding_box.ypos.y << ")" << std::endl;
     std::cout << "(zmin, zmax) = (" << bounding_box.zpos.x << ", " << bounding_box.zpos.y << ")" << std::endl;
     std::cout << "**********" << std::endl;
+    memory_report();
     indexed_uvs.resize(indexed_vertices.size(), glm::vec2(1.)); //List vide de UV
 }
 
@@ -26,18 +43,80 @@ Mesh::Mesh(const char * filename)
 // destructor
 Mesh::~Mesh() = default;
 
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// memory usage
+size_t Mesh::memory_usage() const
+{
+    return valence_field.capacity() * sizeof(float) +
+           indices.capacity() * sizeof(mesh_index) +
+           valences.capacity() * sizeof(unsigned int) +
+           indexed_vertices.capacity() * sizeof(glm::vec3) +
+           indexed_normals.capacity() * sizeof(glm::vec3) +
+           indexed_uvs.capacity() * sizeof(glm::vec2) +
+           m_adjacency.memory_usage() +
+           m_octree_cache->octree.memory_usage() +
+           m_octree_cache->representatives.capacity() * sizeof(glm::vec3) + m_octree_cache->computed.capacity() +
+           m_normal_engine.memory_usage();
+}
+
+void Mesh::memory_report() const
+{
+    size_t total = memory_usage();
+    size_t index_bytes = indices.capacity() * sizeof(mesh_index);
+    unsigned int nb_triangles = getNumberOfTriangles();
+
+    std::cout << "Memory : " << total / 1024.0 << " KB for " << indexed_vertices.size() << " vertices and "
+              << nb_triangles << " triangles" << std::endl;
+    if (nb_triangles > 0)
+    {
+        std::cout << "         " << (double) index_bytes / nb_triangles << " bytes of indices per triangle, "
+                  << (double) total / nb_triangles << " bytes in total per triangle" << std::endl;
+    }
+}
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// adjacency
+const MeshAdjacency & Mesh::adjacency()
+{
+    if (m_adjacency_generation != m_generation || !m_adjacency.matches(indexed_vertices.size(), indices.size()))
+    {
+        m_adjacency.build(indices, getNumberOfVertices());
+        m_adjacency_generation = m_generation;
+    }
+    return m_adjacency;
+}
+
+void Mesh::clear_caches()
+{
+    ++m_generation;
+    m_adjacency.clear();
+    // the copies of the mesh keep the previous octree
+    m_octree_cache = std::make_shared<OctreeCache>();
+}
+
 // ******************************************************************************************************
 // ******************************************************************************************************
 // ******************************************************************************************************
 // normal computation
 void Mesh::compute_smooth_vertex_normals(int weight_type)
 {
-    compute_smooth_vertex_normals(indexed_vertices, triangles, weight_type, indexed_normals);
+    switch (weight_type) {
+        case 1 : compute_smooth_vertex_normals<AreaWeight>(); break;
+        case 2 : compute_smooth_vertex_normals<AngleWeight>(); break;
+        default : compute_smooth_vertex_normals<UniformWeight>(); break;
+    }
 }
 
 void Mesh::compute_vertex_valences()
 {
-    compute_vertex_valences( indexed_vertices, triangles, valences );
+    // valence : size of the one-ring of the vertex
+    const MeshAdjacency & one_ring = adjacency();
+    valences.resize(indexed_vertices.size());
+    parallel_for(valences.size(), 1 << 14, [&](size_t v){ valences[v] = one_ring.valence(v); });
     generate_valence_field();
 }
 
@@ -59,287 +138,535 @@ void Mesh::generate_valence_field ()
 }
 
 
-void Mesh::compute_triangle_normals (const std::vector<glm::vec3> & vertices,
-                                     const std::vector<std::vector<unsigned short> > & triangles,
-                                     std::vector<glm::vec3> & triangle_normals)
+void Mesh::collect_referenced_vertices (std::vector<unsigned int> & vertex_ids) const
 {
-    for(auto triangle : triangles)
-    {
-        glm::vec3 p0 = vertices.at(triangle.at(0));
-        glm::vec3 p1 = vertices.at(triangle.at(1));
-        glm::vec3 p2 = vertices.at(triangle.at(2));
-
-        glm::vec3 n = glm::normalize(glm::cross(p1-p0, p2-p0));
+    const size_t nb_vertices = indexed_vertices.size();
+    std::unique_ptr<std::atomic<unsigned char>[]> referenced(new std::atomic<unsigned char>[nb_vertices]);
+    parallel_for(nb_vertices, 1 << 14, [&](size_t v){ referenced[v].store(0, std::memory_order_relaxed); });
+    parallel_for(indices.size(), 1 << 14, [&](size_t corner){ referenced[indices[corner]].store(1, std::memory_order_relaxed); });
+
+    vertex_ids.clear();
+    vertex_ids.reserve(nb_vertices);
+    for (unsigned int v = 0; v < nb_vertices; ++v) if (referenced[v].load(std::memory_order_relaxed)) vertex_ids.push_back(v);
+}
 
-        triangle_normals.push_back(n);
-    }
+void Mesh::collapse_triangles (const std::vector<unsigned int> & vertex_to_repr, std::vector<mesh_index> & repr_indices) const
+{
+    // each chunk of triangles fills its own list, lists are then concatenated in chunk order
+    const size_t nb_triangles = getNumberOfTriangles();
+    const unsigned int nb_chunks = parallel_nb_chunks(nb_triangles, 1 << 14);
+    std::vector<std::vector<mesh_index>> chunk_indices(nb_chunks);
+    parallel_chunks(nb_triangles, nb_chunks, [&](unsigned int c, size_t begin, size_t end){
+        std::vector<mesh_index> & out = chunk_indices[c];
+        out.reserve(3 * (end - begin));
+        for (size_t t = begin; t < end; ++t) {
+            Triangle triangle(indices, t);
+            mesh_index current_indices[3];
+            for (short i = 0; i < 3; ++i) current_indices[i] = vertex_to_repr[triangle[i]];
+            if( current_indices[0] != current_indices[1] &&
+                current_indices[0] != current_indices[2] &&
+                current_indices[1] != current_indices[2]){
+                out.insert(out.end(), current_indices, current_indices + 3);
+            }
+        }
+    });
+
+    std::vector<size_t> chunk_offset(nb_chunks + 1, 0);
+    for (unsigned int c = 0; c < nb_chunks; ++c) chunk_offset[c + 1] = chunk_offset[c] + chunk_indices[c].size();
+    repr_indices.resize(chunk_offset[nb_chunks]);
+    parallel_chunks(nb_chunks, nb_chunks, [&](unsigned int c, size_t, size_t){
+        std::copy(chunk_indices[c].begin(), chunk_indices[c].end(), repr_indices.begin() + chunk_offset[c]);
+        chunk_indices[c] = std::vector<mesh_index>();
+    });
 }
 
-void Mesh::compute_smooth_vertex_normals (const std::vector<glm::vec3> & vertices,
-                                          const std::vector<std::vector<unsigned short> > & triangles,
-                                          unsigned int weight_type, //0 uniforme, 1 area of triangles, 2 angle of triangle
-                                          std::vector<glm::vec3> & vertex_normals){
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// simplify vertices / normals of the mesh
 
-    vertex_normals.clear();
-    vertex_normals.resize(vertices.size(), glm::vec3(0.0));
+void Mesh::simplify (unsigned int resolution, GridPlacement placement)
+{
+    resolution = std::max(1u, std::min(resolution, SparseGrid::MAX_RESOLUTION));
+    const unsigned int nb_vertices = getNumberOfVertices();
 
-    std::vector<glm::vec3> triangle_normals;
-    std::vector<glm::vec3> triangle_angles;
-    std::vector<float> triangle_surface, point_aire_triangles, point_angles_triangles;
+    // increase bounding box of the mesh to avoid precision issues
+    BOX C = bounding_box;
+    C.xpos += glm::vec2(-0.1 * abs(C.xpos.x), 0.1 * abs(C.xpos.y));
+    C.ypos += glm::vec2(-0.1 * abs(C.ypos.x), 0.1 * abs(C.ypos.y));
+    C.zpos += glm::vec2(-0.1 * abs(C.zpos.x), 0.1 * abs(C.zpos.y));
 
-    compute_triangle_normals(vertices, triangles, triangle_normals);
-    triangle_angles.resize(triangles.size(), glm::vec3(0.0));
-    triangle_surface.resize(triangles.size(),0.0);
-    point_aire_triangles.resize(vertices.size(),0.0f);
-    point_angles_triangles.resize(vertices.size(), 0.0f);
+    // calculate the size of the grid
+    float dx, dy, dz;
+    dx = (C.xpos.y - C.xpos.x) / (float) resolution;
+    dy = (C.ypos.y - C.ypos.x) / (float) resolution;
+    dz = (C.zpos.y - C.zpos.x) / (float) resolution;
 
-    for(unsigned int i = 0; i < triangles.size(); ++i)
+    // for each vertex, we determine once the position P(ix, iy, iz) of its cell
+    // and store the key ix + iy * resolution + iz * resolution^2 of the cell
+    std::vector<uint64_t> vertex_key(nb_vertices);
+    parallel_for(nb_vertices, 1 << 14, [&](size_t v){
+        glm::vec3 p = indexed_vertices[v];
+        uint64_t ix = std::max(0, std::min((int) ((p.x - C.xpos.x) / dx), (int) resolution - 1));
+        uint64_t iy = std::max(0, std::min((int) ((p.y - C.ypos.x) / dy), (int) resolution - 1));
+        uint64_t iz = std::max(0, std::min((int) ((p.z - C.zpos.x) / dz), (int) resolution - 1));
+        vertex_key[v] = ix + resolution * (iy + resolution * iz);
+    });
+
+    // only vertices referenced by a triangle are kept
+    std::vector<unsigned int> sorted_vertices;
+    collect_referenced_vertices(sorted_vertices);
+
+    // group vertices by cell with a stable radix sort on the cell keys : cells end up in
+    // the order of their keys like in a dense grid, and vertices of a cell stay in index order
+    std::vector<uint64_t> sorted_keys(sorted_vertices.size());
+    parallel_for(sorted_vertices.size(), 1 << 14, [&](size_t i){ sorted_keys[i] = vertex_key[sorted_vertices[i]]; });
+    unsigned int key_bits = 0;
+    while (key_bits < 64 && ((uint64_t) resolution * resolution * resolution - 1) >> key_bits) ++key_bits;
+    parallel_radix_sort(sorted_keys, sorted_vertices, key_bits);
+
+    // first sorted vertex of each cell
+    std::vector<unsigned int> cell_start;
+    for (unsigned int i = 0; i < sorted_keys.size(); ++i)
     {
-        glm::vec3 p0 = vertices.at(triangles.at(i).at(0));
-        glm::vec3 p1 = vertices.at(triangles.at(i).at(1));
-        glm::vec3 p2 = vertices.at(triangles.at(i).at(2));
-
-        switch(weight_type){
-            case 0 :
-                // we add normal of the current triangle to each vertex
-                vertex_normals.at(triangles.at(i).at(0)) += triangle_normals.at(i);
-                vertex_normals.at(triangles.at(i).at(1)) += triangle_normals.at(i);
-                vertex_normals.at(triangles.at(i).at(2)) += triangle_normals.at(i);
-                break;
-
-            case 1:
-                // we add area of a triangle to each vertices
-                triangle_surface.at(i) = glm::dot(p1-p0, p2-p0)/2.0f;
-                point_aire_triangles.at(triangles.at(i).at(0)) += triangle_surface.at(i);
-                point_aire_triangles.at(triangles.at(i).at(1)) += triangle_surface.at(i);
-                point_aire_triangles.at(triangles.at(i).at(2)) += triangle_surface.at(i);
-                break;
-
-            case 2:
-                // we add near triangle's area with current triangle of a vertex
-                triangle_angles.at(i).x = acos(glm::radians(glm::dot(p1-p0, p2-p0)/
-                                                            (glm::length(p1-p0) * glm::length(p2-p0))));
-                triangle_angles.at(i).y = acos(glm::radians(glm::dot(p2-p1, p0-p1)/
-                                                            (glm::length(p0-p1) * glm::length(p2-p1))));
-                triangle_angles.at(i).z = acos(glm::radians(glm::dot(p0-p2, p1-p2)/
-                                                            (glm::length(p0-p2) * glm::length(p1-p2))));
-
-                point_angles_triangles.at(triangles.at(i).at(0)) += triangle_angles.at(i).x;
-                point_angles_triangles.at(triangles.at(i).at(1)) += triangle_angles.at(i).y;
-                point_angles_triangles.at(triangles.at(i).at(2)) += triangle_angles.at(i).z;
-                break;
-        }
+        if (i == 0 || sorted_keys[i] != sorted_keys[i - 1]) cell_start.push_back(i);
     }
+    cell_start.push_back(sorted_keys.size());
+
+    // representative vertex of each cell, the box of a cell is given by its key
+    const glm::vec3 grid_min(C.xpos.x, C.ypos.x, C.zpos.x), cell_size(dx, dy, dz);
+    replace_by_clusters(sorted_vertices, cell_start, placement, [&](size_t cell, glm::vec3 & min, glm::vec3 & max){
+        const uint64_t key = sorted_keys[cell_start[cell]];
+        min = grid_min + cell_size * glm::vec3((float) (key % resolution), (float) ((key / resolution) % resolution),
+                                               (float) (key / ((uint64_t) resolution * resolution)));
+        max = min + cell_size;
+    });
+}
 
-    switch(weight_type){
-        case 1 :
-            // we divide the weight of the normal for each triangle with the area
-            for(int i = 0 ; i < triangles.size() ; i++){
-                vertex_normals.at(triangles.at(i).at(0)) += triangle_normals.at(i)*
-                                                            (triangle_surface.at(i)/point_aire_triangles.at(triangles.at(i).at(0)));
-                vertex_normals.at(triangles.at(i).at(1)) += triangle_normals.at(i)*
-                                                            (triangle_surface.at(i)/point_aire_triangles.at(triangles.at(i).at(1)));
-                vertex_normals.at(triangles.at(i).at(2)) += triangle_normals.at(i)*
-                                                            (triangle_surface.at(i)/point_aire_triangles.at(triangles.at(i).at(2)));
-            }
-            break;
-
-        case 2 :
-            // we devide the weight of the normal with each vertex depending of the angle of
-            // near triangles normalize with max angle
-            for(int i = 0 ; i < triangles.size() ; i++){
-                vertex_normals.at(triangles.at(i).at(0)) += triangle_normals.at(i)*
-                                                            (triangle_angles.at(i).x/point_angles_triangles.at(triangles.at(i).at(0)));
-                vertex_normals.at(triangles.at(i).at(1)) += triangle_normals.at(i)*
-                                                            (triangle_angles.at(i).y/point_angles_triangles.at(triangles.at(i).at(1)));
-                vertex_normals.at(triangles.at(i).at(2)) += triangle_normals.at(i)*
-                                                            (triangle_angles.at(i).z/point_angles_triangles.at(triangles.at(i).at(2)));
+unsigned int Mesh::simplifyToTarget (unsigned int target_triangles, GridPlacement placement)
+{
+    const unsigned int nb_vertices = getNumberOfVertices();
+    const unsigned int nb_triangles = getNumberOfTriangles();
+    if (nb_triangles <= target_triangles) return 0;
+
+    // increase bounding box of the mesh to avoid precision issues
+    BOX C = bounding_box;
+    C.xpos += glm::vec2(-0.1 * abs(C.xpos.x), 0.1 * abs(C.xpos.y));
+    C.ypos += glm::vec2(-0.1 * abs(C.ypos.x), 0.1 * abs(C.ypos.y));
+    C.zpos += glm::vec2(-0.1 * abs(C.zpos.x), 0.1 * abs(C.zpos.y));
+
+    // finest grid : 64 times finer along each axis than a grid of one cell per vertex
+    unsigned int max_depth = 6;
+    while (max_depth < 21 && ((uint64_t) 1 << (3 * (max_depth - 6))) < nb_vertices) ++max_depth;
+    const int last = (1 << max_depth) - 1;
+    const glm::vec3 grid_min(C.xpos.x, C.ypos.x, C.zpos.x);
+    const glm::vec3 cell_size = glm::vec3(C.xpos.y - C.xpos.x, C.ypos.y - C.ypos.x, C.zpos.y - C.zpos.x) / (float) (1 << max_depth);
+    auto finest_cell = [&](glm::vec3 p){
+        return glm::ivec3(std::max(0, std::min((int) ((p.x - grid_min.x) / cell_size.x), last)),
+                          std::max(0, std::min((int) ((p.y - grid_min.y) / cell_size.y), last)),
+                          std::max(0, std::min((int) ((p.z - grid_min.z) / cell_size.z), last)));
+    };
+
+    // Morton key of the finest cell of each vertex : its cell in the grid of resolution 2^depth is the key
+    // shifted by 3 * (max_depth - depth), and the vertices sorted by key are sorted by cell at every depth
+    std::vector<uint64_t> vertex_code(nb_vertices);
+    parallel_for(nb_vertices, 1 << 14, [&](size_t v){
+        glm::ivec3 cell = finest_cell(indexed_vertices[v]);
+        vertex_code[v] = SparseGrid::morton(cell.x, cell.y, cell.z);
+    });
+    std::vector<unsigned int> sorted_vertices;
+    collect_referenced_vertices(sorted_vertices);
+    std::vector<uint64_t> sorted_codes(sorted_vertices.size());
+    parallel_for(sorted_vertices.size(), 1 << 14, [&](size_t i){ sorted_codes[i] = vertex_code[sorted_vertices[i]]; });
+    parallel_radix_sort(sorted_codes, sorted_vertices, 3 * max_depth);
+
+    // finest depth within the target by binary search on the number of triangles joining three cells,
+    // depth 0 is a single cell without triangles. The last depth is kept for the splits
+    unsigned int depth = 0, high = max_depth - 1;
+    size_t nb_kept = 0;
+    while (depth < high)
+    {
+        const unsigned int middle = (depth + high + 1) / 2, shift = 3 * (max_depth - middle);
+        const unsigned int nb_chunks = parallel_nb_chunks(nb_triangles, 1 << 14);
+        std::vector<size_t> chunk_count(nb_chunks, 0);
+        parallel_chunks(nb_triangles, nb_chunks, [&](unsigned int chunk, size_t begin, size_t end){
+            size_t count = 0;
+            for (size_t t = begin; t < end; ++t)
+            {
+                Triangle triangle(indices, (unsigned int) t);
+                const uint64_t a = vertex_code[triangle[0]] >> shift, b = vertex_code[triangle[1]] >> shift, c = vertex_code[triangle[2]] >> shift;
+                count += a != b && a != c && b != c;
             }
-            break;
+            chunk_count[chunk] = count;
+        });
+        size_t count = 0;
+        for (size_t c : chunk_count) count += c;
+        if (count <= target_triangles) { depth = middle; nb_kept = count; }
+        else high = middle - 1;
+    }
+
+    // cells of the grid at depth
+    const unsigned int shift = 3 * (max_depth - depth);
+    std::vector<unsigned int> cell_start;
+    for (unsigned int i = 0; i < sorted_codes.size(); ++i)
+    {
+        if (i == 0 || (sorted_codes[i] >> shift) != (sorted_codes[i - 1] >> shift)) cell_start.push_back(i);
+    }
+    const unsigned int nb_cells = cell_start.size();
+    cell_start.push_back(sorted_codes.size());
+    std::vector<unsigned int> vertex_cell(nb_vertices, 0);
+    parallel_for(nb_cells, 1 << 12, [&](size_t cell){
+        for (unsigned int i = cell_start[cell]; i < cell_start[cell + 1]; ++i) vertex_cell[sorted_vertices[i]] = cell;
+    });
+
+    // splitting a cell in its 8 children only changes the triangles with two or three vertices in it :
+    // they are kept when their vertices end up in different children. The gains of the cells add up,
+    // so cells are split in one greedy pass, the largest first, while the target holds
+    std::unique_ptr<std::atomic<unsigned int>[]> gain(new std::atomic<unsigned int>[nb_cells]);
+    parallel_for(nb_cells, 1 << 14, [&](size_t cell){ gain[cell].store(0, std::memory_order_relaxed); });
+    parallel_for(nb_triangles, 1 << 14, [&](size_t t){
+        Triangle triangle(indices, (unsigned int) t);
+        const unsigned int a = vertex_cell[triangle[0]], b = vertex_cell[triangle[1]], c = vertex_cell[triangle[2]];
+        if (a != b && a != c && b != c) return;
+        const uint64_t ca = vertex_code[triangle[0]] >> (shift - 3), cb = vertex_code[triangle[1]] >> (shift - 3),
+                       cc = vertex_code[triangle[2]] >> (shift - 3);
+        if (ca != cb && ca != cc && cb != cc) gain[(a == b || a == c) ? a : b].fetch_add(1, std::memory_order_relaxed);
+    });
+
+    std::vector<unsigned int> order(nb_cells);
+    for (unsigned int cell = 0; cell < nb_cells; ++cell) order[cell] = cell;
+    std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b){
+        return cell_start[a + 1] - cell_start[a] > cell_start[b + 1] - cell_start[b];
+    });
+    std::vector<unsigned char> split(nb_cells, 0);
+    for (unsigned int cell : order)
+    {
+        const unsigned int cell_gain = gain[cell].load(std::memory_order_relaxed);
+        if (cell_gain > 0 && nb_kept + cell_gain <= target_triangles)
+        {
+            split[cell] = 1;
+            nb_kept += cell_gain;
+        }
     }
 
-    // we nomalize normals
-    for(unsigned int i = 0 ; i < vertex_normals.size(); ++i)
+    // label of a vertex : its cell at depth, or its cell at depth + 1 when the cell is split, told apart
+    // by the low bit. Labels are increasing along sorted_vertices so clusters are the runs of equal labels
+    std::vector<uint64_t> label(sorted_vertices.size());
+    parallel_for(sorted_vertices.size(), 1 << 14, [&](size_t i){
+        label[i] = split[vertex_cell[sorted_vertices[i]]] ? ((sorted_codes[i] >> (shift - 3)) << 1) | 1 : (sorted_codes[i] >> shift) << 4;
+    });
+    std::vector<unsigned int> cluster_start;
+    for (unsigned int i = 0; i < label.size(); ++i)
     {
-        vertex_normals.at(i) = glm::normalize(vertex_normals.at(i));
+        if (i == 0 || label[i] != label[i - 1]) cluster_start.push_back(i);
     }
+    cluster_start.push_back(label.size());
+
+    replace_by_clusters(sorted_vertices, cluster_start, placement, [&](size_t cluster, glm::vec3 & min, glm::vec3 & max){
+        const unsigned int first = cluster_start[cluster];
+        const unsigned int coarsening = max_depth - ((label[first] & 1) ? depth + 1 : depth);
+        const glm::ivec3 cell = (finest_cell(indexed_vertices[sorted_vertices[first]]) >> (int) coarsening) << (int) coarsening;
+        min = grid_min + cell_size * glm::vec3(cell);
+        max = min + cell_size * (float) (1 << coarsening);
+    });
+    return 1u << depth;
 }
 
-void Mesh::collect_one_ring (const std::vector<glm::vec3> & vertices,
-                             const std::vector<std::vector<unsigned short> > & triangles,
-                             std::vector<std::vector<unsigned short> > & one_ring)
+void Mesh::replace_by_clusters (const std::vector<unsigned int> & sorted_vertices, const std::vector<unsigned int> & cluster_start,
+                                GridPlacement placement, const std::function<void (size_t, glm::vec3 &, glm::vec3 &)> & cluster_box)
 {
-    one_ring.resize(vertices.size());
+    const unsigned int nb_vertices = getNumberOfVertices();
+    const unsigned int nb_cells = cluster_start.size() - 1;
+    const unsigned int NONE = std::numeric_limits<unsigned int>::max();
 
-    for (unsigned int i = 0 ; i < triangles.size() ; ++i)
+    // for each cell that contains at least one vertex we calculate the position of
+    // the representative vertex using the average of vertices in the cell.
+    // We do the same with normals
+    std::vector<glm::vec3> repr_indexed_vertices(nb_cells), repr_indexed_normals(nb_cells);
+    std::vector<unsigned int> vertex_to_repr(nb_vertices, NONE);
+    parallel_for(nb_cells, 1 << 12, [&](size_t cell){
+        glm::vec3 repr_pos = glm::vec3(0);
+        glm::vec3 repr_norm = glm::vec3(0);
+        for (unsigned int i = cluster_start[cell]; i < cluster_start[cell + 1]; ++i)
+        {
+            repr_pos += indexed_vertices[sorted_vertices[i]];
+            repr_norm += indexed_normals[sorted_vertices[i]];
+            vertex_to_repr[sorted_vertices[i]] = cell;
+        }
+        float count = (float) (cluster_start[cell + 1] - cluster_start[cell]);
+        repr_indexed_vertices[cell] = repr_pos / count;
+        repr_indexed_normals[cell] = repr_norm / count;
+    });
+
+    // quadric placement : once every vertex knows its cell, the planes of the triangles around
+    // the vertices of each cell are accumulated and their minimum, clamped to the cell, replaces
+    // the average. Cells are independent so they are solved in parallel
+    if (placement == GridPlacement::QUADRIC)
     {
-        if (std::find(one_ring.at(triangles.at(i).at(0)).begin(),
-                      one_ring.at(triangles.at(i).at(0)).end(),
-                      triangles.at(i).at(1)) == one_ring.at(triangles.at(i).at(0)).end())
-            one_ring.at(triangles.at(i).at(0)).push_back(triangles.at(i).at(1));
-
-        if (std::find(one_ring.at(triangles.at(i).at(0)).begin(),
-                      one_ring.at(triangles.at(i).at(0)).end(),
-                      triangles.at(i).at(2)) == one_ring.at(triangles.at(i).at(0)).end())
-            one_ring.at(triangles.at(i).at(0)).push_back(triangles.at(i).at(2));
-
-        if (std::find(one_ring.at(triangles.at(i).at(1)).begin(),
-                      one_ring.at(triangles.at(i).at(1)).end(),
-                      triangles.at(i).at(0)) == one_ring.at(triangles.at(i).at(1)).end())
-            one_ring.at(triangles.at(i).at(1)).push_back(triangles.at(i).at(0));
-
-        if (std::find(one_ring.at(triangles.at(i).at(1)).begin(),
-                      one_ring.at(triangles.at(i).at(1)).end(),
-                      triangles.at(i).at(2)) == one_ring.at(triangles.at(i).at(1)).end())
-            one_ring.at(triangles.at(i).at(1)).push_back(triangles.at(i).at(2));
-
-        if (std::find(one_ring.at(triangles.at(i).at(2)).begin(),
-                      one_ring.at(triangles.at(i).at(2)).end(),
-                      triangles.at(i).at(0)) == one_ring.at(triangles.at(i).at(2)).end())
-            one_ring.at(triangles.at(i).at(2)).push_back(triangles.at(i).at(0));
-
-        if (std::find(one_ring.at(triangles.at(i).at(2)).begin(),
-                      one_ring.at(triangles.at(i).at(2)).end(),
-                      triangles.at(i).at(1)) == one_ring.at(triangles.at(i).at(2)).end())
-            one_ring.at(triangles.at(i).at(2)).push_back(triangles.at(i).at(1));
+        const MeshAdjacency & vertex_triangles = adjacency();
+        parallel_for(nb_cells, 1 << 8, [&](size_t cell){
+            glm::vec3 min, max;
+            cluster_box(cell, min, max);
+            repr_indexed_vertices[cell] = cluster_representative(min, max, (unsigned int) cell,
+                                                                 &sorted_vertices[cluster_start[cell]], cluster_start[cell + 1] - cluster_start[cell],
+                                                                 vertex_to_repr, vertex_triangles, true);
+        });
     }
-}
-
 
-void Mesh::compute_vertex_valences (const std::vector<glm::vec3> & vertices,
-                                    const std::vector<std::vector<unsigned short> > & triangles,
-                                    std::vector<unsigned int> & valences)
-{
-    valences.resize(vertices.size());
-    std::vector<std::vector<unsigned short> >  one_ring;
-    collect_one_ring(vertices, triangles, one_ring);
+    // for each triangle, we verify which index of representative vertex is
+    // for each triangle's vertex. If all indices are different then we keep the triangle.
+    std::vector<mesh_index> repr_indices;
+    collapse_triangles(vertex_to_repr, repr_indices);
 
-    for (unsigned int i = 0; i < vertices.size(); ++i){
-        valences.at(i) = one_ring.at(i).size();
+    // we substitute old vectors with new one
+    if(indexed_vertices.size() > repr_indexed_vertices.size()) {
+        indices.swap(repr_indices);
+        indexed_vertices.swap(repr_indexed_vertices);
+        indexed_normals.swap(repr_indexed_normals);
+        clear_caches();
     }
+    else {std::cout << "minimum simplification" << std::endl;}
 }
 
-// ******************************************************************************************************
-// ******************************************************************************************************
-// ******************************************************************************************************
-// load off file
+namespace {
 
+// temporary file removed with the object
+struct TemporaryFile {
+    std::string name;
+    ~TemporaryFile() { if (!name.empty()) { std::error_code error; std::filesystem::remove(name, error); } }
+};
 
-bool Mesh::load_OFF_file(const std::string & filename, std::vector< glm::vec3 > & vertices,
-                         std::vector< glm::vec3 > & normals, std::vector< unsigned short > & indices,
-                         std::vector< std::vector<unsigned short > > & triangles,
-                         glm::vec2 & xpos, glm::vec2 & ypos, glm::vec2 & zpos)
+// rotation of the triangle starting with its lowest id, orientation is kept
+inline std::array<unsigned int, 3> canonical_triangle(unsigned int a, unsigned int b, unsigned int c)
 {
-    std::ifstream myfile; myfile.open(filename.c_str());
-    if (!myfile.is_open())
-    {
-        std::cout << "Failure to open " <<filename << " file"<< std::endl;
-        return false;
-    }
+    if (a < b && a < c) return {a, b, c};
+    if (b < c) return {b, c, a};
+    return {c, a, b};
+}
+
+} // namespace
 
-    std::string isOFFfile; myfile >> isOFFfile;
-    if(isOFFfile != "OFF")
+bool Mesh::simplifyStreaming (const std::string & filename, unsigned int resolution, size_t memory_budget, bool use_cache)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    resolution = std::max(1u, std::min(resolution, SparseGrid::MAX_RESOLUTION));
+
+    // blocks of 1/16 of the budget : the text of a block and its parsed records take about 4 times the block
+    MeshStream stream(filename, use_cache, std::min<size_t>(memory_budget / 16, (size_t) 64 << 20));
+    if (!stream.valid())
     {
-        std::cerr << "File " << filename << " isn't an OFF format file" << std::endl;
-        myfile.close();
+        std::cerr << stream.error() << std::endl;
         return false;
     }
-
-    int numberOfVertices , numberOfFaces , numberOfEdges;
-    myfile >> numberOfVertices >> numberOfFaces >> numberOfEdges;
-
-    vertices.resize(numberOfVertices);
-    normals.resize(numberOfVertices);
-
-    std::vector< std::vector<glm::vec3> > normalsTmp;
-    normalsTmp.resize(numberOfVertices);
-
-
-    for( int v = 0 ; v < numberOfVertices ; ++v )
+    const size_t nb_vertices = stream.getNumberOfVertices();
+
+    // the triangles need the positions of their vertices, which come first in the file : they are kept
+    // in memory when they take less than half of the budget, in a temporary file mapped in memory
+    // otherwise (its pages are read on demand and can be evicted at any time)
+    const bool spill = nb_vertices * sizeof(glm::vec3) > memory_budget / 2;
+    std::vector<glm::vec3> positions;
+    TemporaryFile spill_file;
+    std::ofstream spill_out;
+    std::unique_ptr<MappedFile> spill_map;
+    const glm::vec3 * vertices = nullptr;
+    if (spill)
     {
-        glm::vec3 vertex;
-        myfile >> vertex.x >> vertex.y >> vertex.z;
-        vertices[v] = vertex;
-
-        if(v == 0)
+        spill_file.name = (std::filesystem::temp_directory_path() / ("meshsimp_vertices_" +
+                           std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()))).string();
+        spill_out.open(spill_file.name.c_str(), std::ios::binary | std::ios::trunc);
+    }
+    else positions.resize(nb_vertices);
+    glm::vec3 bmin(FLT_MAX), bmax(-FLT_MAX);
+
+    // grid on the bounding box of the vertices, enlarged like in simplify
+    BOX C;
+    glm::vec3 cell_size(1.0f);
+    auto cell_key = [&](glm::vec3 p){
+        unsigned int ix = std::max(0, std::min((int) ((p.x - C.xpos.x) / cell_size.x), (int) resolution - 1));
+        unsigned int iy = std::max(0, std::min((int) ((p.y - C.ypos.x) / cell_size.y), (int) resolution - 1));
+        unsigned int iz = std::max(0, std::min((int) ((p.z - C.zpos.x) / cell_size.z), (int) resolution - 1));
+        return SparseGrid::pack(ix, iy, iz);
+    };
+
+    // occupied cells : sum of the plane quadrics of the triangles around their vertices and sum of these
+    // vertices, and the triangles whose vertices are in three different cells, as cell triples. A vertex
+    // is added to the sum of its cell by its first triangle only (seen has a bit per vertex), so that the
+    // average isn't weighted by the valences, like the average of simplify
+    SparseGrid grid;
+    std::vector<Quadric> cell_quadrics;
+    std::vector<glm::dvec3> cell_sums;
+    std::vector<unsigned int> cell_counts;
+    std::vector<uint64_t> seen((nb_vertices + 63) / 64, 0);
+    std::vector<std::array<unsigned int, 3>> triangles;
+    size_t compacted = 0, peak_bytes = 0;
+
+    // triangles are processed by batches : keys and planes in parallel, then accumulated in file
+    // order so that the result doesn't depend on the number of threads
+    const size_t BATCH_TRIANGLE_BYTES = 3 * sizeof(uint64_t) + 3 * sizeof(glm::vec3) + sizeof(glm::vec4);
+    const size_t BATCH = std::max<size_t>(1 << 12, std::min<size_t>(1 << 18, memory_budget / 32 / BATCH_TRIANGLE_BYTES));
+    std::vector<uint64_t> batch_keys(3 * BATCH);
+    std::vector<glm::vec3> batch_corners(3 * BATCH);
+    std::vector<glm::vec4> batch_planes(BATCH);
+    std::string error;
+
+    auto on_vertices = [&](size_t first, const std::vector<glm::vec3> & block){
+        for (const glm::vec3 & p : block)
         {
-            xpos.x = vertex.x; xpos.y = vertex.x;
-            ypos.x = vertex.y; ypos.y = vertex.y;
-            zpos.x = vertex.z; zpos.y = vertex.z;
+            bmin = glm::min(bmin, p);
+            bmax = glm::max(bmax, p);
         }
-        else
+        if (!spill) std::copy(block.begin(), block.end(), positions.begin() + first);
+        else if (!spill_out.write((const char *) block.data(), (std::streamsize) (block.size() * sizeof(glm::vec3))))
         {
-            if(xpos.x > vertex.x) xpos.x = vertex.x;
-            if(xpos.y < vertex.x) xpos.y = vertex.x;
-
-            if(ypos.x > vertex.y) ypos.x = vertex.y;
-            if(ypos.y < vertex.y) ypos.y = vertex.y;
-
-            if(zpos.x > vertex.z) zpos.x = vertex.z;
-            if(zpos.y < vertex.z) zpos.y = vertex.z;
+            error = "Failure to write " + spill_file.name + " file";
+            return false;
         }
-    }
-
+        return true;
+    };
 
-    for( int f = 0 ; f < numberOfFaces ; ++f )
-    {
-        int numberOfVerticesOnFace;
-        myfile >> numberOfVerticesOnFace;
-        if( numberOfVerticesOnFace == 3 )
+    auto on_triangles = [&](size_t first, const std::vector<uint32_t> & block){
+        if (first == 0)
         {
-            unsigned short v1 , v2 , v3;
-            std::vector< unsigned short > v;
-            myfile >> v1 >> v2 >> v3;
-
-            v.push_back(v1);
-            v.push_back(v2);
-            v.push_back(v3);
-
-            triangles.push_back(v);
+            // all the vertices are read
+            if (spill)
+            {
+                spill_out.close();
+                spill_map.reset(new MappedFile(spill_file.name));
+                if (!spill_out || !spill_map->valid() || spill_map->size() != nb_vertices * sizeof(glm::vec3))
+                {
+                    error = "Failure to read " + spill_file.name + " file";
+                    return false;
+                }
+                vertices = (const glm::vec3 *) spill_map->begin();
+            }
+            else vertices = positions.data();
+
+            C.xpos = glm::vec2(bmin.x, bmax.x);
+            C.ypos = glm::vec2(bmin.y, bmax.y);
+            C.zpos = glm::vec2(bmin.z, bmax.z);
+            C.xpos += glm::vec2(-0.1 * abs(C.xpos.x), 0.1 * abs(C.xpos.y));
+            C.ypos += glm::vec2(-0.1 * abs(C.ypos.x), 0.1 * abs(C.ypos.y));
+            C.zpos += glm::vec2(-0.1 * abs(C.zpos.x), 0.1 * abs(C.zpos.y));
+            cell_size = C.dimension() / (float) resolution;
+        }
 
-            indices.push_back(v1);
-            indices.push_back(v2);
-            indices.push_back(v3);
+        const size_t nb_block_triangles = block.size() / 3;
+        for (size_t batch = 0; batch < nb_block_triangles; batch += BATCH)
+        {
+            const size_t nb_batch_triangles = std::min(BATCH, nb_block_triangles - batch);
+            parallel_for(nb_batch_triangles, 1 << 12, [&](size_t t){
+                const uint32_t * triangle = &block[3 * (batch + t)];
+                for (int i = 0; i < 3; ++i)
+                {
+                    batch_corners[3 * t + i] = vertices[triangle[i]];
+                    batch_keys[3 * t + i] = cell_key(batch_corners[3 * t + i]);
+                }
+                const glm::vec3 * p = &batch_corners[3 * t];
+                batch_planes[t] = equation_plane(p[0].x, p[0].y, p[0].z, p[1].x, p[1].y, p[1].z, p[2].x, p[2].y, p[2].z);
+            });
+
+            for (size_t t = 0; t < nb_batch_triangles; ++t)
+            {
+                unsigned int ids[3];
+                const Quadric Qt(batch_planes[t]);
+                for (int i = 0; i < 3; ++i)
+                {
+                    ids[i] = grid.insert(batch_keys[3 * t + i]);
+                    if (ids[i] == cell_quadrics.size())
+                    {
+                        cell_quadrics.emplace_back();
+                        cell_sums.emplace_back(0.0);
+                        cell_counts.push_back(0);
+                    }
+                    cell_quadrics[ids[i]] += Qt;
+                    const uint32_t v = block[3 * (batch + t) + i];
+                    if (!(seen[v >> 6] & (1ull << (v & 63))))
+                    {
+                        seen[v >> 6] |= 1ull << (v & 63);
+                        cell_sums[ids[i]] += glm::dvec3(batch_corners[3 * t + i]);
+                        cell_counts[ids[i]]++;
+                    }
+                }
+                if (ids[0] != ids[1] && ids[0] != ids[2] && ids[1] != ids[2]) triangles.push_back(canonical_triangle(ids[0], ids[1], ids[2]));
+            }
 
-            glm::vec3 normal;
-            glm::vec3 tmp1 = vertices[v2] - vertices[v1];
-            glm::vec3 tmp2 = vertices[v3] - vertices[v1];
-            normal = glm::normalize(glm::cross(tmp1,tmp2));
-            normalsTmp[v1].push_back(normal);
-            normalsTmp[v2].push_back(normal);
-            normalsTmp[v3].push_back(normal);
+            // many triangles of the file give the same triangle of cells : duplicates are removed
+            // whenever the list doubles, so that it only depends on the resolution
+            if (triangles.size() >= std::max<size_t>(2 * compacted, 1 << 16))
+            {
+                std::sort(triangles.begin(), triangles.end());
+                triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+                compacted = triangles.size();
+            }
 
+            const size_t bytes = stream.memory_usage() + positions.capacity() * sizeof(glm::vec3) +
+                                 seen.capacity() * sizeof(uint64_t) + BATCH * BATCH_TRIANGLE_BYTES + grid.memory_usage() +
+                                 cell_quadrics.capacity() * sizeof(Quadric) + cell_sums.capacity() * sizeof(glm::dvec3) +
+                                 cell_counts.capacity() * sizeof(unsigned int) + triangles.capacity() * sizeof(triangles[0]);
+            peak_bytes = std::max(peak_bytes, bytes);
+            if (bytes > memory_budget)
+            {
+                error = "Memory budget of " + std::to_string(memory_budget >> 20) + " MB exceeded at resolution " +
+                        std::to_string(resolution) + " (" + std::to_string(grid.size()) + " cells, " +
+                        std::to_string(triangles.size()) + " triangles)";
+                return false;
+            }
         }
-        else
-        {
-            std::cerr << "Number of vertices on face must be 3" << std::endl;
-            myfile.close();
-            return false;
-        }
+        return true;
+    };
+
+    if (!stream.read(on_vertices, on_triangles))
+    {
+        std::cerr << (stream.valid() ? error : stream.error()) << std::endl;
+        return false;
     }
+    std::sort(triangles.begin(), triangles.end());
+    triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
 
-    for( int v = 0 ; v < numberOfVertices ; ++v )
+    const size_t nb_cells = grid.size();
+    if (nb_cells > (size_t) std::numeric_limits<mesh_index>::max() + 1)
     {
-        float sizeTmp = normalsTmp[v].size();
-        glm::vec3 tmp;
-        for(auto n : normalsTmp[v])
-        {
-            tmp += n;
-        }
-        tmp = tmp / sizeTmp;
-        normals[v] = tmp;
+        std::cerr << nb_cells << " cells don't fit in " << sizeof(mesh_index) * 8 << "-bit indices" << std::endl;
+        return false;
     }
 
-    myfile.close();
+    // representative vertex of each cell : minimum of its quadric, or average of its vertices
+    // when the minimum doesn't exist or is outside of the cell
+    *this = Mesh();
+    if (nb_vertices > 0)
+    {
+        bounding_box.xpos = glm::vec2(bmin.x, bmax.x);
+        bounding_box.ypos = glm::vec2(bmin.y, bmax.y);
+        bounding_box.zpos = glm::vec2(bmin.z, bmax.z);
+    }
+    indexed_vertices.resize(nb_cells);
+    parallel_for(nb_cells, 1 << 12, [&](size_t cell){
+        const uint64_t key = grid.keys()[cell], mask = (1u << 21) - 1;
+        const glm::vec3 min = glm::vec3(C.xpos.x, C.ypos.x, C.zpos.x) +
+                              cell_size * glm::vec3((float) (key & mask), (float) ((key >> 21) & mask), (float) (key >> 42));
+        const glm::vec3 max = min + cell_size;
+        glm::vec3 repr;
+        bool use_minimum = cell_quadrics[cell].minimise(repr) &&
+                           repr.x >= min.x && repr.x <= max.x && repr.y >= min.y && repr.y <= max.y && repr.z >= min.z && repr.z <= max.z;
+        if (!use_minimum) repr = glm::vec3(cell_sums[cell] / (double) cell_counts[cell]);
+        indexed_vertices[cell] = repr;
+    });
+    indices.resize(3 * triangles.size());
+    parallel_for(triangles.size(), 1 << 14, [&](size_t t){
+        for (int i = 0; i < 3; ++i) indices[3 * t + i] = (mesh_index) triangles[t][i];
+    });
+    indexed_uvs.resize(indexed_vertices.size(), glm::vec2(1.));
+    compute_smooth_vertex_normals<UniformWeight>();
+
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "Streamed " << nb_vertices << " vertices and " << stream.getNumberOfTriangles() << " triangles from "
+              << (stream.from_cache() ? "the cache" : "the OFF file") << " in " << seconds * 1000.0 << " ms : " << nb_cells
+              << " cells, " << triangles.size() << " triangles, peak of " << peak_bytes / (1024.0 * 1024.0) << " MB"
+              << (spill ? " (vertices in a temporary file)" : "") << std::endl;
     return true;
 }
 
-// ******************************************************************************************************
-// ******************************************************************************************************
-// ******************************************************************************************************
-// simplify vertices / normals of the mesh
-
-void Mesh::simplify (unsigned int resolution)
+void Mesh::simplifyDense (unsigned int resolution)
 {
     std::vector<std::vector<unsigned int>> grid;
     std::vector<unsigned int> grid_indices;
@@ -348,8 +675,7 @@ void Mesh::simplify (unsigned int resolution)
     grid_indices.resize(grid.size());
 
 
-    std::vector<unsigned short> repr_indices;
-    std::vector<std::vector<unsigned short> > repr_triangles;
+    std::vector<mesh_index> repr_indices;
     std::vector<glm::vec3> repr_indexed_vertices, repr_indexed_normals;
 
     // increase bounding box of the mesh to avoid precision issues
@@ -366,16 +692,17 @@ void Mesh::simplify (unsigned int resolution)
 
     // for each vertex of a triangle, we determine the position P(ix, iy, iz)
     // and place the vertex' index in the grid at position P
-    for (auto triangle : triangles) {
+    for (unsigned int t = 0; t < getNumberOfTriangles(); ++t) {
+        Triangle triangle(indices, t);
         for (int i = 0; i < 3; ++i) {
-            glm::vec3 v = indexed_vertices.at(triangle.at(i));
+            glm::vec3 v = indexed_vertices.at(triangle[i]);
 
             int ix = (v.x - C.xpos.x) / dx;
             int iy = (v.y - C.ypos.x) / dy;
             int iz = (v.z - C.zpos.x) / dz;
 
-            if(std::count(grid.at(ix + iy * resolution + iz * pow(resolution, 2)).begin(), grid.at(ix + iy * resolution + iz * pow(resolution, 2)).end(), triangle.at(i)) == 0)
-                grid.at(ix + iy * resolution + iz * pow(resolution, 2)).push_back(triangle.at(i));
+            if(std::count(grid.at(ix + iy * resolution + iz * pow(resolution, 2)).begin(), grid.at(ix + iy * resolution + iz * pow(resolution, 2)).end(), triangle[i]) == 0)
+                grid.at(ix + iy * resolution + iz * pow(resolution, 2)).push_back(triangle[i]);
         }
     }
 
@@ -407,10 +734,11 @@ void Mesh::simplify (unsigned int resolution)
     // for each triangle, we verify which index of representative vertex is
     // for each triangle's vertex. If all indices are different then we add
     // indices of the triangles else, we don't keep these vertices
-    for (auto triangle: triangles) {
-        short current_indices[3];
+    for (unsigned int t = 0; t < getNumberOfTriangles(); ++t) {
+        Triangle triangle(indices, t);
+        mesh_index current_indices[3];
         for (short i = 0; i < 3; ++i) {
-            glm::vec3 v = indexed_vertices.at(triangle.at(i));
+            glm::vec3 v = indexed_vertices.at(triangle[i]);
 
             int ix = (v.x - C.xpos.x) / dx;
             int iy = (v.y - C.ypos.x) / dy;
@@ -424,21 +752,15 @@ void Mesh::simplify (unsigned int resolution)
             repr_indices.push_back(current_indices[0]);
             repr_indices.push_back(current_indices[1]);
             repr_indices.push_back(current_indices[2]);
-
-            std::vector<unsigned short> tmp;
-            tmp.push_back(current_indices[0]);
-            tmp.push_back(current_indices[1]);
-            tmp.push_back(current_indices[2]);
-            repr_triangles.push_back(tmp);
         }
     }
 
     // we substitute old vectors with new one
     if(indexed_vertices.size() > repr_indexed_vertices.size()) {
         indices = repr_indices;
-        triangles = repr_triangles;
         indexed_vertices = repr_indexed_vertices;
         indexed_normals = repr_indexed_normals;
+        clear_caches();
     }
     else {std::cout << "minimum simplification" << std::endl;}
 }
@@ -447,136 +769,224 @@ void Mesh::simplify (unsigned int resolution)
 
 void Mesh::adaptiveSimplify (unsigned int numOfPerLeafVertices)
 {
+    const unsigned int leaf_size = std::max(numOfPerLeafVertices, 1u);
+    // the cache is shared with the copies of the mesh, and outlives the lock when the mesh drops it
+    std::shared_ptr<OctreeCache> shared_cache = m_octree_cache;
+    OctreeCache & cache = *shared_cache;
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    // build the octree of the vertices referenced by a triangle, unless it was built
+    // for this generation of the mesh with at most leaf_size vertices per leaf
+    if (cache.octree.nodes().empty() || cache.generation != m_generation || cache.octree.max_per_leaf() > leaf_size)
+    {
+        // increase bounding box of the mesh to avoid precision issues
+        BOX C = bounding_box;
+        C.xpos += glm::vec2(-0.1 * abs(C.xpos.x), 0.1 * abs(C.xpos.y));
+        C.ypos += glm::vec2(-0.1 * abs(C.ypos.x), 0.1 * abs(C.ypos.y));
+        C.zpos += glm::vec2(-0.1 * abs(C.zpos.x), 0.1 * abs(C.zpos.y));
+
+        std::vector<unsigned int> vertex_ids;
+        collect_referenced_vertices(vertex_ids);
+        cache.octree.build(indexed_vertices, vertex_ids, glm::vec3(C.xpos.x, C.ypos.x, C.zpos.x),
+                           glm::vec3(C.xpos.y, C.ypos.y, C.zpos.y), std::min(leaf_size, OCTREE_LEAF_SIZE));
+        cache.generation = m_generation;
+        cache.representatives.assign(cache.octree.nodes().size(), glm::vec3(0.0f));
+        cache.computed.assign(cache.octree.nodes().size(), 0);
+    }
+    const LinearOctree & octree = cache.octree;
+
+    // each non-empty leaf of the cut gives one representative vertex, in Morton order
+    std::vector<unsigned int> leaf_nodes;
+    octree.cut(leaf_size, leaf_nodes);
+    std::vector<LinearOctree::Node> leaves(leaf_nodes.size());
+    for (unsigned int l = 0; l < leaves.size(); ++l) leaves[l] = octree.node(leaf_nodes[l]);
+
+    // vertices of the leaves in increasing order, as in the leaves of a new octree
+    std::vector<unsigned int> vertices(octree.vertices());
+    task_parallel_for(leaves.size(), 1 << 10, [&](size_t l){
+        if (!leaves[l].is_leaf()) std::sort(vertices.begin() + leaves[l].begin, vertices.begin() + leaves[l].end);
+    });
+
     std::vector<unsigned int> vertices_to_repr;
-    std::vector<unsigned short> repr_indices;
-    std::vector<std::vector<unsigned short> > repr_triangles;
     std::vector<glm::vec3> repr_indexed_vertices, repr_indexed_normals;
-    vertices_to_repr.resize(indexed_vertices.size());
+    compute_leaf_representatives(vertices, leaves, vertices_to_repr, repr_indexed_vertices, &leaf_nodes, &cache);
+
+    // for each triangle, if vertices of a triangle have a different representative vertex then
+    // we store indices and triangle of this representative vertex as final vertex
+    std::vector<mesh_index> repr_indices;
+    collapse_triangles(vertices_to_repr, repr_indices);
 
+    // we substitute old vectors with new one
+    if(indexed_vertices.size() > repr_indexed_vertices.size()){
+        indices.swap(repr_indices);
+        indexed_vertices.swap(repr_indexed_vertices);
+        indexed_normals.swap(repr_indexed_normals);
+        clear_caches();
+    }
+    else{std::cout << "minimum simplification" << std::endl;}
+}
+
+void Mesh::compute_leaf_representatives (const std::vector<unsigned int> & vertices, const std::vector<LinearOctree::Node> & leaves,
+                                         std::vector<unsigned int> & vertices_to_repr, std::vector<glm::vec3> & repr_indexed_vertices,
+                                         const std::vector<unsigned int> * leaf_nodes, OctreeCache * cache)
+{
+    vertices_to_repr.assign(getNumberOfVertices(), LinearOctree::NONE);
+    repr_indexed_vertices.resize(leaves.size());
+
+    task_parallel_for(leaves.size(), 1 << 10, [&](size_t l){
+        for (unsigned int i = leaves[l].begin; i < leaves[l].end; ++i) vertices_to_repr[vertices[i]] = (unsigned int) l;
+    });
+
+    // representative vertices minimise the quadric error of the triangles around the leaf vertices,
+    // leaves are independent so their quadrics are solved in parallel
+    const MeshAdjacency & vertex_triangles = adjacency();
+
+    // the representative of a node only depends on its vertices : the ones of the cache are reused
+    task_parallel_for(leaves.size(), 1 << 8, [&](size_t l){
+        const unsigned int node = cache ? (*leaf_nodes)[l] : 0;
+        if (cache && cache->computed[node]) { repr_indexed_vertices[l] = cache->representatives[node]; return; }
+
+        const LinearOctree::Node & leaf = leaves[l];
+        repr_indexed_vertices[l] = cluster_representative(leaf.min, leaf.max, (unsigned int) l, &vertices[leaf.begin], leaf.size(),
+                                                          vertices_to_repr, vertex_triangles, false);
+        if (cache) { cache->representatives[node] = repr_indexed_vertices[l]; cache->computed[node] = 1; }
+    });
+}
+
+glm::vec3 Mesh::cluster_representative (glm::vec3 min, glm::vec3 max, unsigned int cluster, const unsigned int * cluster_vertices,
+                                        unsigned int nb_cluster_vertices, const std::vector<unsigned int> & vertices_to_repr,
+                                        const MeshAdjacency & adjacency, bool clamp)
+{
+    // sum of the quadrics of the planes of the triangles around the cluster vertices,
+    // a triangle is counted by the first of its vertices belonging to the cluster
+    Quadric Qp;
+    for (unsigned int i = 0; i < nb_cluster_vertices; ++i) {
+        const unsigned int v = cluster_vertices[i];
+        for (const unsigned int * corner = adjacency.corners_begin(v); corner != adjacency.corners_end(v); ++corner) {
+            Triangle triangle(indices, *corner / 3);
+            short first = 0;
+            while (vertices_to_repr[triangle[first]] != cluster) ++first;
+            if (triangle[first] != v) continue;
+
+            const glm::vec3 & p0 = indexed_vertices[triangle[0]], & p1 = indexed_vertices[triangle[1]], & p2 = indexed_vertices[triangle[2]];
+            Qp += Quadric(equation_plane(p0.x, p0.y, p0.z, p1.x, p1.y, p1.z, p2.x, p2.y, p2.z));
+        }
+    }
+
+    // the minimum doesn't exist (flat or degenerate cluster) or is outside of the cluster without clamp :
+    // use the average of its vertices instead
+    glm::vec3 repr;
+    bool use_minimum = Qp.minimise(repr);
+    if (use_minimum && clamp) repr = glm::clamp(repr, min, max);
+    else if (use_minimum) {
+        use_minimum = repr.x >= min.x && repr.x <= max.x && repr.y >= min.y && repr.y <= max.y && repr.z >= min.z && repr.z <= max.z;
+    }
+    if (!use_minimum) {
+        repr = glm::vec3(0.0f);
+        for (unsigned int i = 0; i < nb_cluster_vertices; ++i) repr += indexed_vertices[cluster_vertices[i]];
+        repr /= (float) nb_cluster_vertices;
+    }
+    return repr;
+}
+
+void Mesh::adaptiveSimplifyRecursive (unsigned int numOfPerLeafVertices)
+{
     // increase bounding box of the mesh to avoid precision issues
     BOX C = bounding_box;
     C.xpos += glm::vec2(-0.1 * abs(C.xpos.x), 0.1 * abs(C.xpos.y));
     C.ypos += glm::vec2(-0.1 * abs(C.ypos.x), 0.1 * abs(C.ypos.y));
     C.zpos += glm::vec2(-0.1 * abs(C.zpos.x), 0.1 * abs(C.zpos.y));
 
-    // create an octree and start the recursivity
-    m_octree = std::make_shared<Octree>(C.xpos.x, C.xpos.y, C.ypos.x, C.ypos.y, C.zpos.x, C.zpos.y);
-    adaptiveSimplifyRec(m_octree, numOfPerLeafVertices, vertices_to_repr, repr_indexed_vertices, triangles);
+    // start the recursivity with all the vertices referenced by a triangle,
+    // subtrees are built by tasks of the pool
+    std::vector<unsigned int> vertex_ids;
+    collect_referenced_vertices(vertex_ids);
+
+    TaskPool & pool = TaskPool::instance();
+    TaskPool::Group group;
+    std::mutex leaves_mutex;
+    std::vector<LinearOctree::Node> leaves, root_leaves;
+    adaptiveSimplifyRec(glm::vec3(C.xpos.x, C.ypos.x, C.zpos.x), glm::vec3(C.xpos.y, C.ypos.y, C.zpos.y), 0,
+                        vertex_ids.data(), 0, (unsigned int) vertex_ids.size(), std::max(numOfPerLeafVertices, 1u),
+                        pool, group, leaves_mutex, leaves, root_leaves);
+    pool.wait(group);
+    leaves.insert(leaves.end(), root_leaves.begin(), root_leaves.end());
+
+    // leaves are disjoint ranges of vertex_ids : sorted by range they come in depth-first
+    // order whatever the order of the tasks
+    std::sort(leaves.begin(), leaves.end(), [](const LinearOctree::Node & a, const LinearOctree::Node & b){ return a.begin < b.begin; });
+
+    std::vector<unsigned int> vertices_to_repr;
+    std::vector<glm::vec3> repr_indexed_vertices, repr_indexed_normals;
+    compute_leaf_representatives(vertex_ids, leaves, vertices_to_repr, repr_indexed_vertices);
 
     // for each triangle, if vertices of a triangle have a different representative vertex then
     // we store indices and triangle of this representative vertex as final vertex
-    for(unsigned int i = 0 ; i < triangles.size(); i++){
-        short current_indices[3];
-        for(int j = 0 ; j < 3 ; j ++){ current_indices[j] = vertices_to_repr.at(triangles.at(i).at(j));}
-
-        // all representatives vertices of the triangle are different
-        if( current_indices[0] != current_indices[1] && current_indices[0] != current_indices[2] &&
-            current_indices[1] != current_indices[2])
-        {
-            repr_indices.push_back(current_indices[0]);
-            repr_indices.push_back(current_indices[1]);
-            repr_indices.push_back(current_indices[2]);
-
-            std::vector<unsigned short> tmp;
-            tmp.push_back(current_indices[0]);
-            tmp.push_back(current_indices[1]);
-            tmp.push_back(current_indices[2]);
-            repr_triangles.push_back(tmp);
-        }
-    }
+    std::vector<mesh_index> repr_indices;
+    collapse_triangles(vertices_to_repr, repr_indices);
 
     // we substitute old vectors with new one
     if(indexed_vertices.size() > repr_indexed_vertices.size()){
-        indices = repr_indices;
-        triangles = repr_triangles;
-        indexed_vertices = repr_indexed_vertices;
-        indexed_normals = repr_indexed_normals;
+        indices.swap(repr_indices);
+        indexed_vertices.swap(repr_indexed_vertices);
+        indexed_normals.swap(repr_indexed_normals);
+        clear_caches();
     }
     else{std::cout << "minimum simplification" << std::endl;}
 }
 
-void Mesh::adaptiveSimplifyRec (std::shared_ptr<Octree> octree, unsigned int numOfPerLeafVertices, std::vector<unsigned int> & vertices_to_repr,
-                                std::vector<glm::vec3> & repr_indexed_vertices, std::vector<std::vector<unsigned short>> in_triangles)
+void Mesh::adaptiveSimplifyRec (glm::vec3 min, glm::vec3 max, unsigned int depth, unsigned int * vertex_ids, unsigned int begin, unsigned int end,
+                                unsigned int numOfPerLeafVertices, TaskPool & pool, TaskPool::Group & group,
+                                std::mutex & leaves_mutex, std::vector<LinearOctree::Node> & leaves,
+                                std::vector<LinearOctree::Node> & task_leaves)
 {
-    std::vector<std::vector<unsigned short>> out_triangles;
-    std::unordered_map<int, bool> seen_vertices_map, seen_triangles_map;
-    unsigned int lastJ = std::numeric_limits<unsigned int>::max();
-    bool is_leaf = true;
-
-    for (unsigned int j = 0 ; j < in_triangles.size(); ++j)
-    {
-        for(short i = 0 ; i < 3 ; i ++){
-            if(octree->containsVertex(indexed_vertices.at(in_triangles.at(j).at(i)))){
-                if(seen_vertices_map.find(in_triangles.at(j).at(i)) == seen_vertices_map.end()){
-                    octree->putIndex(in_triangles.at(j).at(i));
-                    seen_vertices_map[in_triangles.at(j).at(i)] = true;
-                    if (seen_triangles_map.find(j) == seen_triangles_map.end()) seen_triangles_map[j] = true;
-                }
-                if(j!=lastJ){
-                    out_triangles.push_back(in_triangles.at(j));
-                    lastJ = j;
-                }
-            }
-
-            if(is_leaf && octree->getIndices().size() > numOfPerLeafVertices) {
-                is_leaf = false;
-                octree->generateChildren();
-            }
-        }
+    if (begin == end) return;
+
+    // leaf : all its vertices share one representative vertex,
+    // vertices in increasing order like in the leaves of LinearOctree
+    if (end - begin <= numOfPerLeafVertices || depth == LinearOctree::MAX_DEPTH) {
+        std::sort(vertex_ids + begin, vertex_ids + end);
+        task_leaves.push_back(LinearOctree::Node{min, max, begin, end, LinearOctree::NONE, depth});
+        return;
     }
 
-    if(!is_leaf){
-        for(short k = 0 ; k < 8 ; k++)
-            adaptiveSimplifyRec(octree->getChild(k), numOfPerLeafVertices, vertices_to_repr, repr_indexed_vertices, out_triangles);
+    // partition the vertices of the node in place between its 8 children, in the child order of
+    // LinearOctree : a vertex on a midpoint goes with high x, high y and low z like in its Morton code
+    glm::vec3 middle = min + (max - min) / 2.0f;
+    auto left = [&](unsigned int v){ return !(indexed_vertices[v].x >= middle.x); };
+    auto bottom = [&](unsigned int v){ return !(indexed_vertices[v].y >= middle.y); };
+    auto back = [&](unsigned int v){ return !(indexed_vertices[v].z <= middle.z); };
+
+    unsigned int * bounds[9];
+    bounds[0] = vertex_ids + begin; bounds[8] = vertex_ids + end;
+    bounds[4] = std::partition(bounds[0], bounds[8], back);
+    for (int z = 0; z < 2; ++z) {
+        bounds[4 * z + 2] = std::partition(bounds[4 * z], bounds[4 * z + 4], bottom);
+        for (int y = 0; y < 2; ++y) bounds[4 * z + 2 * y + 1] = std::partition(bounds[4 * z + 2 * y], bounds[4 * z + 2 * y + 2], left);
     }
 
-    if(is_leaf){
-        glm::vec3 repr = glm::vec3(0.0f);
-
-        // for quadric error calculation
-        glm::vec4 repr_tmp = glm::vec4(0.0f);
-        glm::mat4 Qp(glm::mat4(0.0f)), Qp_inv(glm::mat4(0.0f));
-
-        for (auto kv : seen_triangles_map){
-            glm::vec4 plane = equation_plane (
-                    indexed_vertices.at(triangles.at(kv.first).at(0)).x, indexed_vertices.at(triangles.at(kv.first).at(0)).y, indexed_vertices.at(triangles.at(kv.first).at(0)).z,
-                    indexed_vertices.at(triangles.at(kv.first).at(1)).x, indexed_vertices.at(triangles.at(kv.first).at(1)).y, indexed_vertices.at(triangles.at(kv.first).at(1)).z,
-                    indexed_vertices.at(triangles.at(kv.first).at(2)).x, indexed_vertices.at(triangles.at(kv.first).at(2)).y, indexed_vertices.at(triangles.at(kv.first).at(2)).z
-            ) ;
-            glm::mat4 Q = glm::mat4(pow(plane.x,2) , plane.x*plane.y   , plane.x*plane.z   , plane.x*plane.w,
-                                    plane.x*plane.y  , pow(plane.y,2)    , plane.y*plane.z   , plane.y*plane.w,
-                                    plane.x*plane.z , plane.y*plane.z   , pow(plane.z,2)    , plane.z*plane.w,
-                                    plane.x*plane.w , plane.y*plane.w   , plane.z*plane.w   , pow(plane.w,2));
-
-            //glm::mat4 Q;
-            Q[0][0] = pow(plane.x,2); Q[1][0] = plane.x*plane.y; Q[2][0] = plane.x*plane.z; Q[3][0] = plane.x*plane.w;
-            Q[0][1] = plane.x*plane.y; Q[1][1] = pow(plane.y,2); Q[2][1] = plane.y*plane.z; Q[3][1] = plane.y*plane.w;
-            Q[0][2] = plane.x*plane.z; Q[1][2] = plane.y*plane.z; Q[2][2] = pow(plane.z,2); Q[3][2] = plane.z*plane.w;
-            Q[0][3] = plane.x*plane.w; Q[1][3] = plane.y*plane.w; Q[2][3] = plane.z*plane.w; Q[3][3] = pow(plane.w,2);
-            Qp += Q;
+    for (unsigned int child = 0; child < 8; ++child) {
+        glm::vec3 child_min = min, child_max = max;
+        if (child & 1) child_min.x = middle.x; else child_max.x = middle.x;
+        if (child & 2) child_min.y = middle.y; else child_max.y = middle.y;
+        if (child & 4) child_max.z = middle.z; else child_min.z = middle.z;
+        unsigned int child_begin = bounds[child] - vertex_ids, child_end = bounds[child + 1] - vertex_ids;
+
+        // big subtrees are new tasks, collecting their own leaves
+        if (child_end - child_begin > LinearOctree::SUBTREE_CUTOFF) {
+            pool.run(group, [=, &pool, &group, &leaves_mutex, &leaves](){
+                std::vector<LinearOctree::Node> subtree_leaves;
+                adaptiveSimplifyRec(child_min, child_max, depth + 1, vertex_ids, child_begin, child_end, numOfPerLeafVertices,
+                                    pool, group, leaves_mutex, leaves, subtree_leaves);
+                std::lock_guard<std::mutex> lock(leaves_mutex);
+                leaves.insert(leaves.end(), subtree_leaves.begin(), subtree_leaves.end());
+            });
         }
-        Qp[0][3]=0; Qp[1][3]=0; Qp[2][3]=0; Qp[3][3]=1;
-        bool inversible = (glm::determinant(Qp) != 0);
-
-        if(inversible){
-            Qp_inv = glm::inverse(Qp);
-            repr_tmp = Qp_inv * glm::vec4(0,0,0,1);
-
-            repr.x = repr_tmp.x;
-            repr.y = repr_tmp.y;
-            repr.z = repr_tmp.z;
-        }
-        bool outside = false;
-        if(!octree->containsVertex(repr)){ outside = true; repr = glm::vec3(0.0f);};
-
-        for(unsigned int i = 0 ; i < octree->getIndices().size() ; ++i){
-            if(outside) repr += indexed_vertices.at(octree->getIndexAt(i));
-            vertices_to_repr.at(octree->getIndexAt(i)) = repr_indexed_vertices.size();
+        else {
+            adaptiveSimplifyRec(child_min, child_max, depth + 1, vertex_ids, child_begin, child_end, numOfPerLeafVertices,
+                                pool, group, leaves_mutex, leaves, task_leaves);
         }
-
-        if(outside) repr /= (float) octree->getIndices().size();
-        repr_indexed_vertices.push_back(repr);
-    } // if(is_leaf)
+    }
 }
 
 
@@ -0,0 +1,81 @@
+#include "Mesh.hpp"
+#include "Parallel.hpp"
+
+#include <atomic>
+#include <memory>
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// compressed sparse row adjacency
+//
+// corners_start : 0 3 5 ...        corners of v : corners[corners_start[v]] ... corners[corners_start[v + 1] - 1]
+// corners       : 0 4 9 | 1 3 | ...
+//
+// neighbours_start and neighbours are laid out the same way
+void MeshAdjacency::build (const std::vector<mesh_index> & indices, unsigned int nb_vertices)
+{
+    const size_t nb_corners = indices.size();
+
+    // vertex -> triangle : count the corners of each vertex, then each corner takes the next slot of its vertex
+    std::vector<unsigned int> counts(nb_vertices, 0);
+    m_corners_start.resize(nb_vertices + 1);
+    m_corners.resize(nb_corners);
+    if (parallel_nb_chunks(nb_corners, 1 << 16) == 1) {
+        // in corner order the corners of each vertex come in increasing order
+        for (mesh_index v : indices) counts[v]++;
+        m_corners_start[0] = 0;
+        for (unsigned int v = 0; v < nb_vertices; ++v) m_corners_start[v + 1] = m_corners_start[v] + counts[v];
+        std::copy(m_corners_start.begin(), m_corners_start.end() - 1, counts.begin());
+        for (unsigned int corner = 0; corner < nb_corners; ++corner) m_corners[counts[indices[corner]]++] = corner;
+    }
+    else {
+        // threads take the slots in any order : the corners of each vertex are sorted afterwards
+        std::unique_ptr<std::atomic<unsigned int>[]> slot(new std::atomic<unsigned int>[nb_vertices]);
+        parallel_for(nb_vertices, 1 << 14, [&](size_t v){ slot[v].store(0, std::memory_order_relaxed); });
+        parallel_for(nb_corners, 1 << 14, [&](size_t corner){ slot[indices[corner]].fetch_add(1, std::memory_order_relaxed); });
+        m_corners_start[0] = 0;
+        for (unsigned int v = 0; v < nb_vertices; ++v) m_corners_start[v + 1] = m_corners_start[v] + slot[v].load(std::memory_order_relaxed);
+
+        parallel_for(nb_vertices, 1 << 14, [&](size_t v){ slot[v].store(m_corners_start[v], std::memory_order_relaxed); });
+        parallel_for(nb_corners, 1 << 14, [&](size_t corner){
+            m_corners[slot[indices[corner]].fetch_add(1, std::memory_order_relaxed)] = (unsigned int) corner;
+        });
+        parallel_for(nb_vertices, 1 << 12, [&](size_t v){
+            std::sort(m_corners.begin() + m_corners_start[v], m_corners.begin() + m_corners_start[v + 1]);
+        });
+    }
+
+    // vertex -> vertex : the one-ring of each vertex is gathered from its triangles in the
+    // space of its two other corners per triangle and counted, then the rings are packed
+    std::vector<mesh_index> rings(2 * nb_corners);
+    parallel_for(nb_vertices, 1 << 12, [&](size_t v){
+        mesh_index * ring = rings.data() + 2 * (size_t) m_corners_start[v];
+        mesh_index * last = ring;
+        for (const unsigned int * corner = corners_begin(v); corner != corners_end(v); ++corner) {
+            const unsigned int first = *corner - *corner % 3;
+            *last++ = indices[first + (*corner + 1) % 3];
+            *last++ = indices[first + (*corner + 2) % 3];
+        }
+        std::sort(ring, last);
+        counts[v] = (unsigned int) (std::unique(ring, last) - ring);
+    });
+
+    m_neighbours_start.resize(nb_vertices + 1);
+    m_neighbours_start[0] = 0;
+    for (unsigned int v = 0; v < nb_vertices; ++v) m_neighbours_start[v + 1] = m_neighbours_start[v] + counts[v];
+
+    m_neighbours.resize(m_neighbours_start[nb_vertices]);
+    parallel_for(nb_vertices, 1 << 12, [&](size_t v){
+        const mesh_index * ring = rings.data() + 2 * (size_t) m_corners_start[v];
+        std::copy(ring, ring + counts[v], m_neighbours.begin() + m_neighbours_start[v]);
+    });
+}
+
+void MeshAdjacency::clear ()
+{
+    m_corners_start = std::vector<unsigned int>();
+    m_corners = std::vector<unsigned int>();
+    m_neighbours_start = std::vector<unsigned int>();
+    m_neighbours = std::vector<mesh_index>();
+}
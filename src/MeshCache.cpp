@@ -0,0 +1,232 @@
+#include "Mesh.hpp"
+#include "MappedFile.hpp"
+#include "MeshStream.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// binary cache format
+//
+// MeshCacheHeader | vertices | normals | indices
+//
+// each section is padded to 8 bytes, the checksum covers everything after the header. The adjacency isn't
+// stored, it is built again in linear time when it is needed
+namespace {
+
+const char MESH_CACHE_MAGIC[8] = {'M', 'E', 'S', 'H', 'C', 'A', 'C', 'H'};
+const uint32_t MESH_CACHE_VERSION = 1;
+
+struct MeshCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t index_size;            // sizeof(mesh_index) of the writer
+    uint64_t source_size;           // size of the OFF file in bytes
+    int64_t source_mtime;           // last write time of the OFF file
+    uint64_t nb_vertices;
+    uint64_t nb_indices;
+    float bounding_box[6];          // xmin, xmax, ymin, ymax, zmin, zmax
+    uint64_t checksum;
+};
+
+inline size_t padded(size_t size) {return (size + 7) & ~(size_t) 7;}
+
+// 64-bit checksum, 32 bytes at a time on four independent lanes
+uint64_t checksum64(const char * data, size_t size)
+{
+    uint64_t lanes[4] = {0x9E3779B97F4A7C15ull ^ size, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull, 0x27D4EB2F165667C5ull};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        for (int l = 0; l < 4; ++l)
+        {
+            uint64_t word; std::memcpy(&word, data + i + 8 * l, 8);
+            lanes[l] = (lanes[l] ^ word) * 0xFF51AFD7ED558CCDull;
+            lanes[l] ^= lanes[l] >> 32;
+        }
+    }
+    uint64_t h = lanes[0] ^ (lanes[1] * 31) ^ (lanes[2] * 961) ^ (lanes[3] * 29791);
+    for (; i < size; ++i) h = (h ^ (unsigned char) data[i]) * 0x100000001B3ull;
+    h ^= h >> 33; h *= 0xC4CEB9FE1A85EC53ull; h ^= h >> 33;
+    return h;
+}
+
+// size and last write time of the source file, false if it doesn't exist
+bool source_stamp(const std::string & filename, uint64_t & size, int64_t & mtime)
+{
+    std::error_code error;
+    size = std::filesystem::file_size(filename, error);
+    if (error) return false;
+    auto time = std::filesystem::last_write_time(filename, error);
+    if (error) return false;
+    mtime = (int64_t) time.time_since_epoch().count();
+    return true;
+}
+
+} // namespace
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// read / write the binary cache of an OFF file
+
+std::string Mesh::cache_filename(const std::string & filename)
+{
+    return filename + ".mcache";
+}
+
+bool Mesh::load_cache_file(const std::string & filename)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    uint64_t source_size; int64_t source_mtime;
+    if (!source_stamp(filename, source_size, source_mtime)) return false;
+
+    MappedFile file(cache_filename(filename));
+    if (!file.valid() || file.size() < sizeof(MeshCacheHeader)) return false;
+
+    MeshCacheHeader header{};
+    std::memcpy(&header, file.begin(), sizeof(MeshCacheHeader));
+    if (std::memcmp(header.magic, MESH_CACHE_MAGIC, 8) != 0 || header.version != MESH_CACHE_VERSION ||
+        header.index_size != sizeof(mesh_index) || header.nb_indices % 3 != 0)
+    {
+        return false;
+    }
+
+    // the source was modified since the cache was written
+    if (header.source_size != source_size || header.source_mtime != source_mtime) return false;
+
+    size_t vertices_bytes = padded(header.nb_vertices * sizeof(glm::vec3));
+    size_t indices_bytes = padded(header.nb_indices * sizeof(mesh_index));
+    size_t payload_bytes = 2 * vertices_bytes + indices_bytes;
+    if (file.size() != sizeof(MeshCacheHeader) + payload_bytes) return false;
+
+    const char * payload = file.begin() + sizeof(MeshCacheHeader);
+    if (checksum64(payload, payload_bytes) != header.checksum)
+    {
+        std::cerr << "Cache of " << filename << " is corrupted, it will be rebuilt" << std::endl;
+        return false;
+    }
+
+    // copy each section into the mesh buffers, no parsing involved
+    indexed_vertices.resize(header.nb_vertices);
+    indexed_normals.resize(header.nb_vertices);
+    indices.resize(header.nb_indices);
+    std::memcpy(indexed_vertices.data(), payload, header.nb_vertices * sizeof(glm::vec3));
+    std::memcpy(indexed_normals.data(), payload + vertices_bytes, header.nb_vertices * sizeof(glm::vec3));
+    std::memcpy(indices.data(), payload + 2 * vertices_bytes, header.nb_indices * sizeof(mesh_index));
+
+    // a cache written by another build passes the checksum : its indices are checked like the ones of an OFF file
+    const unsigned int nb_chunks = (unsigned int) std::min<size_t>(parallel_num_threads(), std::max<size_t>(indices.size() >> 16, 1));
+    std::vector<unsigned char> chunk_valid(nb_chunks, 1);
+    parallel_chunks(indices.size(), nb_chunks, [&](unsigned int c, size_t begin, size_t end){
+        for (size_t i = begin; i < end; ++i) if (indices[i] >= header.nb_vertices) { chunk_valid[c] = 0; return; }
+    });
+    if (std::find(chunk_valid.begin(), chunk_valid.end(), 0) != chunk_valid.end())
+    {
+        std::cerr << "Cache of " << filename << " has invalid faces, it will be rebuilt" << std::endl;
+        indexed_vertices.clear();
+        indexed_normals.clear();
+        indices.clear();
+        return false;
+    }
+
+    bounding_box.xpos = glm::vec2(header.bounding_box[0], header.bounding_box[1]);
+    bounding_box.ypos = glm::vec2(header.bounding_box[2], header.bounding_box[3]);
+    bounding_box.zpos = glm::vec2(header.bounding_box[4], header.bounding_box[5]);
+
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "Loaded cache " << cache_filename(filename) << " in " << seconds * 1000.0 << " ms" << std::endl;
+    return true;
+}
+
+bool Mesh::write_cache_file(const std::string & filename) const
+{
+    MeshCacheHeader header{};
+    std::memcpy(header.magic, MESH_CACHE_MAGIC, 8);
+    header.version = MESH_CACHE_VERSION;
+    header.index_size = sizeof(mesh_index);
+    if (!source_stamp(filename, header.source_size, header.source_mtime)) return false;
+    header.nb_vertices = indexed_vertices.size();
+    header.nb_indices = indices.size();
+    header.bounding_box[0] = bounding_box.xpos.x; header.bounding_box[1] = bounding_box.xpos.y;
+    header.bounding_box[2] = bounding_box.ypos.x; header.bounding_box[3] = bounding_box.ypos.y;
+    header.bounding_box[4] = bounding_box.zpos.x; header.bounding_box[5] = bounding_box.zpos.y;
+
+    // payload with each section padded to 8 bytes
+    size_t vertices_bytes = padded(indexed_vertices.size() * sizeof(glm::vec3));
+    size_t indices_bytes = padded(indices.size() * sizeof(mesh_index));
+    std::vector<char> payload(2 * vertices_bytes + indices_bytes, 0);
+    std::memcpy(payload.data(), indexed_vertices.data(), indexed_vertices.size() * sizeof(glm::vec3));
+    std::memcpy(payload.data() + vertices_bytes, indexed_normals.data(), indexed_normals.size() * sizeof(glm::vec3));
+    std::memcpy(payload.data() + 2 * vertices_bytes, indices.data(), indices.size() * sizeof(mesh_index));
+    header.checksum = checksum64(payload.data(), payload.size());
+
+    // write in a temporary file then rename it, so that readers never see a partial cache
+    std::string cache = cache_filename(filename), tmp = cache + ".tmp";
+    {
+        std::ofstream out(tmp.c_str(), std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+        out.write((const char *) &header, sizeof(MeshCacheHeader));
+        out.write(payload.data(), payload.size());
+        if (!out.good()) { out.close(); std::remove(tmp.c_str()); return false; }
+    }
+    std::error_code error;
+    std::filesystem::rename(tmp, cache, error);
+    if (error) { std::remove(tmp.c_str()); return false; }
+    return true;
+}
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// sections of the binary cache of an OFF file, read by MeshStream
+
+bool MeshStream::open_cache(const std::string & filename, std::string & cache, size_t & nb_vertices, size_t & nb_indices,
+                            uint64_t & vertices_offset, uint64_t & indices_offset, uint32_t & index_size)
+{
+    uint64_t source_size; int64_t source_mtime;
+    if (!source_stamp(filename, source_size, source_mtime)) return false;
+
+    cache = Mesh::cache_filename(filename);
+    std::ifstream in(cache.c_str(), std::ios::binary);
+    MeshCacheHeader header{};
+    if (!in.read((char *) &header, sizeof(MeshCacheHeader))) return false;
+    if (std::memcmp(header.magic, MESH_CACHE_MAGIC, 8) != 0 || header.version != MESH_CACHE_VERSION ||
+        (header.index_size != 2 && header.index_size != 4) || header.nb_indices % 3 != 0)
+    {
+        return false;
+    }
+    if (header.source_size != source_size || header.source_mtime != source_mtime) return false;
+
+    // same layout as load_cache_file : the file must hold all the sections
+    size_t vertices_bytes = padded(header.nb_vertices * sizeof(glm::vec3));
+    size_t indices_bytes = padded(header.nb_indices * header.index_size);
+    size_t payload_bytes = 2 * vertices_bytes + indices_bytes;
+    std::error_code error;
+    if (std::filesystem::file_size(cache, error) != sizeof(MeshCacheHeader) + payload_bytes) return false;
+
+    // the checksum is verified like in load_cache_file, on a map of the file : its pages are read once and
+    // can be evicted at any time, so the extra pass stays within the memory of the stream. A corrupted
+    // cache is ignored and the OFF file is streamed instead
+    MappedFile file(cache);
+    if (!file.valid() || file.size() != sizeof(MeshCacheHeader) + payload_bytes) return false;
+    if (checksum64(file.begin() + sizeof(MeshCacheHeader), payload_bytes) != header.checksum)
+    {
+        std::cerr << "Cache of " << filename << " is corrupted, the OFF file is streamed instead" << std::endl;
+        return false;
+    }
+
+    nb_vertices = header.nb_vertices;
+    nb_indices = header.nb_indices;
+    vertices_offset = sizeof(MeshCacheHeader);
+    indices_offset = sizeof(MeshCacheHeader) + 2 * vertices_bytes;
+    index_size = header.index_size;
+    return true;
+}
@@ -0,0 +1,910 @@
+#include "Mesh.hpp"
+#include "IndexedHeap.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// edge collapse driven by quadric errors (Garland and Heckbert, Surface Simplification Using Quadric
+// Error Metrics, 1997) on flat arrays :
+//
+// - each vertex has the quadric of the planes of its triangles (and of planes through its boundary edges)
+// - the heap holds one entry per vertex, keyed by the cost of its cheapest collapse. Merging quadrics only
+//   adds positive semi-definite terms, so costs never decrease : a key made stale by a collapse nearby stays
+//   a lower bound and is evaluated again only when it reaches the top (lazy invalidation), the vertex is
+//   then collapsed or its key raised
+// - the triangles around each vertex are a range of a pool, the merged ranges of a collapse are written
+//   at the end of the pool, which is compacted when it has doubled
+namespace {
+
+const unsigned int NONE = std::numeric_limits<unsigned int>::max();
+
+// weight of the planes through the boundary edges, perpendicular to their triangle
+const double BOUNDARY_WEIGHT = 100.0;
+
+// smallest cosine between the normals of a triangle before and after a collapse
+const double MIN_NORMAL_COSINE = 0.2;
+
+// the collapses of a round of run_parallel cost at most this quantile of the costs of the round
+const double ROUND_QUANTILE = 0.25;
+
+class EdgeCollapse {
+public:
+    EdgeCollapse (const std::vector<glm::vec3> & vertices, const std::vector<mesh_index> & indices, const MeshAdjacency & adjacency)
+        : m_positions(vertices), m_triangles(indices.begin(), indices.end()), m_quadrics(vertices.size()),
+          m_triangle_removed(indices.size() / 3, 0), m_start(vertices.size()), m_size(vertices.size()),
+          m_best(vertices.size())
+    {
+        const unsigned int nb_vertices = (unsigned int) vertices.size();
+        m_nb_triangles = indices.size() / 3;
+
+        // triangles around each vertex, from the corners of the adjacency
+        m_pool.resize(indices.size());
+        const unsigned int * corners = nb_vertices > 0 ? adjacency.corners_begin(0) : nullptr;
+        parallel_for(nb_vertices, 1 << 14, [&](size_t v){
+            m_start[v] = (unsigned int) (adjacency.corners_begin(v) - corners);
+            m_size[v] = adjacency.nb_triangles(v);
+            for (unsigned int i = 0; i < m_size[v]; ++i) m_pool[m_start[v] + i] = corners[m_start[v] + i] / 3;
+        });
+        m_initial_pool = m_pool.size();
+
+        // quadric of each vertex, each vertex sums its own planes so vertices are independent
+        parallel_for(nb_vertices, 1 << 12, [&](size_t v){
+            Quadric q;
+            for (unsigned int i = 0; i < m_size[v]; ++i) {
+                const unsigned int t = m_pool[m_start[v] + i];
+                const glm::dvec3 normal = triangle_normal(t);
+                const double length = glm::length(normal);
+                if (length == 0.0) continue;
+                const glm::dvec3 p(m_positions[v]), n = normal / length;
+                q += Quadric(n.x, n.y, n.z, -glm::dot(n, p));
+
+                // edges of v in t shared with no other triangle around v are on the boundary
+                for (short c = 0; c < 3; ++c) {
+                    const unsigned int x = m_triangles[3 * t + c];
+                    if (x == v || count_triangles(v, x) != 1) continue;
+                    const glm::dvec3 edge = glm::dvec3(m_positions[x]) - p;
+                    glm::dvec3 b = glm::cross(edge, n);
+                    const double b_length = glm::length(b);
+                    if (b_length == 0.0) continue;
+                    b /= b_length;
+                    q += Quadric(b.x, b.y, b.z, -glm::dot(b, p)) * BOUNDARY_WEIGHT;
+                }
+            }
+            m_quadrics[v] = q;
+        });
+
+    }
+
+    // collapse edges until at most target_triangles remain or the next collapse costs more than max_error.
+    // The heap is built by the first run, the next runs continue the collapses to a smaller target
+    void run (unsigned int target_triangles, double max_error) {
+        if (!m_heap_built) {
+            // cheapest collapse of each vertex, without the topological checks
+            const unsigned int nb_vertices = (unsigned int) m_positions.size();
+            std::vector<double> keys(nb_vertices);
+            const unsigned int nb_chunks = parallel_nb_chunks(nb_vertices, 1 << 12);
+            parallel_chunks(nb_vertices, nb_chunks, [&](unsigned int, size_t begin, size_t end){
+                std::vector<unsigned int> ring;
+                for (size_t v = begin; v < end; ++v) {
+                    const Candidate best = best_collapse((unsigned int) v, ring);
+                    keys[v] = best.cost;
+                    m_best[v] = Best{best.target, best.position};
+                }
+            });
+            m_heap.build(keys);
+            for (unsigned int v = 0; v < nb_vertices; ++v) if (m_size[v] == 0) m_heap.remove(v);
+            m_heap_built = true;
+        }
+
+        while (m_nb_triangles > target_triangles && !m_heap.empty()) {
+            const unsigned int v = m_heap.top();
+            const double key = m_heap.key(v);
+            if (key > max_error) break;
+
+            // the cheapest collapse of v is evaluated again when its key may be stale
+            if (m_best[v].target == NONE) {
+                const Candidate best = best_collapse(v, m_scratch.ring);
+                if (best.target == NONE) { m_heap.remove(v); continue; }
+                m_best[v] = Best{best.target, best.position};
+                if (best.cost > key) {
+                    // an entry cheaper than this one may be waiting in the heap
+                    m_heap.update(v, best.cost);
+                    continue;
+                }
+            }
+
+            // when it is refused the next ones by increasing cost, v waits for a change of its neighbourhood when none is valid
+            const Candidate best{key, m_best[v].target, m_best[v].position};
+            const Candidate * collapse = can_collapse(v, best.target, best.position, m_scratch) ? &best : nullptr;
+            if (collapse == nullptr) {
+                rank_collapses(v, m_scratch.ring, m_scratch.candidates);
+                for (const Candidate & candidate : m_scratch.candidates) {
+                    if (candidate.target == best.target) continue;
+                    if (candidate.cost > key) {
+                        m_heap.update(v, candidate.cost);
+                        m_best[v] = Best{candidate.target, candidate.position};
+                        break;
+                    }
+                    if (can_collapse(v, candidate.target, candidate.position, m_scratch)) { collapse = &candidate; break; }
+                }
+            }
+            if (collapse == nullptr) {
+                if (m_heap.contains(v) && m_heap.key(v) == key) {
+                    m_heap.remove(v);
+                    m_best[v].target = NONE;
+                }
+                continue;
+            }
+            apply(v, collapse->target, collapse->position, key);
+        }
+    }
+
+    // collapse edges by rounds until at most target_triangles remain or every collapse costs more than max_error.
+    // Each round evaluates the cheapest valid collapse of the vertices whose neighbourhood changed, keeps the
+    // collapses cheaper than a quantile of these costs, and among them the collapses with the smallest cost
+    // over every vertex they touch (the vertices of the triangles around both ends) : the collapses of a round
+    // share no vertex and no triangle, they are applied in parallel and the result doesn't depend on the number
+    // of threads. Returns the number of collapses of each round
+    std::vector<unsigned int> run_parallel (unsigned int target_triangles, double max_error) {
+        const unsigned int nb_vertices = (unsigned int) m_positions.size();
+        std::vector<unsigned int> rounds, active, candidates, pending, selected, removed, touched_start, touched;
+        std::vector<uint64_t> priorities;
+        std::vector<size_t> offsets, chunk_start;
+        std::vector<double> cost(nb_vertices, std::numeric_limits<double>::infinity()), costs;
+        // like the keys of run, the cost of a vertex is evaluated again when its cheapest collapse changed,
+        // with the checks of can_collapse when it was refused
+        enum : unsigned char { CLEAN, STALE, REFUSED };
+        std::vector<unsigned char> dirty(nb_vertices, STALE);
+        std::unique_ptr<std::atomic<uint64_t>[]> owner(new std::atomic<uint64_t>[nb_vertices]);
+        // claimed[w] is the number of the round that claimed w, mark[w] the stamp of the last candidate that
+        // listed w : neither is reset between rounds. Two candidates racing on a mark only list w twice
+        std::vector<unsigned int> claimed(nb_vertices, 0);
+        std::unique_ptr<std::atomic<unsigned int>[]> mark(new std::atomic<unsigned int>[nb_vertices]);
+        unsigned int stamp = 0;
+        parallel_for(nb_vertices, 1 << 14, [&](size_t v){ mark[v].store(0, std::memory_order_relaxed); });
+        for (unsigned int v = 0; v < nb_vertices; ++v) if (m_size[v] > 0) active.push_back(v);
+
+        // scratch lists and partial results of each chunk, reused by every round
+        struct Chunk {
+            Scratch scratch;
+            std::vector<unsigned int> list;
+            std::vector<double> costs;
+        };
+        std::vector<Chunk> chunks(parallel_num_threads());
+
+        // priority of the collapse of v : its cost rounded to 4 bits of mantissa, then a bijective hash of v.
+        // Costs are non-negative, the bits of their float have the order of the costs. Costs vary smoothly over
+        // the surface and so do vertex ids : exact costs or ids chain the collapses of a neighbourhood and the
+        // selection needs as many passes, rounded costs and hashes keep it about logarithmic
+        auto priority = [&](unsigned int v){
+            const float key = (float) cost[v];
+            uint32_t bits, hash = v;
+            std::memcpy(&bits, &key, sizeof(bits));
+            bits &= ~((1u << 19) - 1);
+            hash = (hash ^ (hash >> 16)) * 0x45d9f3bu;
+            hash = (hash ^ (hash >> 16)) * 0x45d9f3bu;
+            hash ^= hash >> 16;
+            return ((uint64_t) bits << 32) | hash;
+        };
+
+        // the lists of the chunks one after the other in out, in parallel
+        auto concatenate = [&](unsigned int nb_chunks, auto member, auto & out){
+            chunk_start.assign(nb_chunks + 1, 0);
+            for (unsigned int c = 0; c < nb_chunks; ++c) chunk_start[c + 1] = chunk_start[c] + (chunks[c].*member).size();
+            out.resize(chunk_start[nb_chunks]);
+            parallel_chunks(nb_chunks, nb_chunks, [&](unsigned int c, size_t, size_t){
+                std::copy((chunks[c].*member).begin(), (chunks[c].*member).end(), out.begin() + (ptrdiff_t) chunk_start[c]);
+            });
+        };
+
+        while (m_nb_triangles > target_triangles) {
+            const unsigned int round = (unsigned int) rounds.size() + 1;
+
+            // cheapest collapse of the vertices whose neighbourhood changed, and the costs of the round
+            const unsigned int nb_chunks = parallel_nb_chunks(active.size(), 1 << 10);
+            parallel_chunks(active.size(), nb_chunks, [&](unsigned int chunk, size_t begin, size_t end){
+                Chunk & local = chunks[chunk];
+                local.costs.clear();
+                for (size_t i = begin; i < end; ++i) {
+                    const unsigned int v = active[i];
+                    if (dirty[v] != CLEAN) {
+                        const Candidate best = dirty[v] == REFUSED ? best_valid_collapse(v, local.scratch) : best_collapse(v, local.scratch.ring);
+                        dirty[v] = CLEAN;
+                        cost[v] = best.cost;
+                        m_best[v] = Best{best.target, best.position};
+                    }
+                    if (m_best[v].target != NONE && cost[v] <= max_error) local.costs.push_back(cost[v]);
+                }
+            });
+
+            // collapses of the round cheaper than the quantile
+            concatenate(nb_chunks, &Chunk::costs, costs);
+            if (costs.empty()) break;
+            auto quantile = costs.begin() + (ptrdiff_t) ((double) (costs.size() - 1) * ROUND_QUANTILE);
+            std::nth_element(costs.begin(), quantile, costs.end());
+            const double threshold = *quantile;
+            candidates = filter(active, [&](unsigned int v){ return m_best[v].target != NONE && cost[v] <= threshold; });
+
+            // vertices touched by each candidate once each, with its priority : the ends of the candidates of a
+            // chunk are first counted from the start of its list
+            if (stamp > std::numeric_limits<unsigned int>::max() - candidates.size()) {
+                parallel_for(nb_vertices, 1 << 14, [&](size_t v){ mark[v].store(0, std::memory_order_relaxed); });
+                stamp = 0;
+            }
+            const unsigned int nb_candidate_chunks = parallel_nb_chunks(candidates.size(), 1 << 10);
+            touched_start.resize(candidates.size() + 1);
+            touched_start[0] = 0;
+            priorities.resize(candidates.size());
+            parallel_chunks(candidates.size(), nb_candidate_chunks, [&](unsigned int chunk, size_t begin, size_t end){
+                std::vector<unsigned int> & list = chunks[chunk].list;
+                list.clear();
+                for (size_t i = begin; i < end; ++i) {
+                    const unsigned int s = stamp + (unsigned int) i + 1;
+                    for_each_touched(candidates[i], m_best[candidates[i]].target, [&](unsigned int w){
+                        if (mark[w].load(std::memory_order_relaxed) == s) return;
+                        mark[w].store(s, std::memory_order_relaxed);
+                        owner[w].store(UINT64_MAX, std::memory_order_relaxed);
+                        list.push_back(w);
+                    });
+                    touched_start[i + 1] = (unsigned int) list.size();
+                    priorities[i] = priority(candidates[i]);
+                }
+            });
+            stamp += (unsigned int) candidates.size();
+            chunk_start.assign(nb_candidate_chunks + 1, 0);
+            for (unsigned int c = 0; c < nb_candidate_chunks; ++c) chunk_start[c + 1] = chunk_start[c] + chunks[c].list.size();
+            touched.resize(chunk_start[nb_candidate_chunks]);
+            parallel_chunks(candidates.size(), nb_candidate_chunks, [&](unsigned int chunk, size_t begin, size_t end){
+                std::copy(chunks[chunk].list.begin(), chunks[chunk].list.end(), touched.begin() + (ptrdiff_t) chunk_start[chunk]);
+                for (size_t i = begin; i < end; ++i) touched_start[i + 1] += (unsigned int) chunk_start[chunk];
+            });
+            auto for_each_vertex = [&](unsigned int i, auto && f){
+                for (unsigned int k = touched_start[i]; k < touched_start[i + 1]; ++k) f(touched[k]);
+            };
+
+            // maximal set of collapses touching separate vertices, by passes (Luby) : each vertex keeps the smallest
+            // priority of the pending collapses touching it, the collapses owning every vertex they touch are selected
+            // and claim these vertices, the pending collapses touching a claimed vertex are dropped and the others
+            // reset the owners of their vertices for the next pass
+            pending.resize(candidates.size());
+            for (unsigned int i = 0; i < pending.size(); ++i) pending[i] = i;
+            selected.clear();
+            while (!pending.empty()) {
+                const unsigned int nb_pending_chunks = parallel_nb_chunks(pending.size(), 1 << 10);
+                parallel_chunks(pending.size(), nb_pending_chunks, [&](unsigned int, size_t begin, size_t end){
+                    for (size_t i = begin; i < end; ++i) {
+                        const uint64_t p = priorities[pending[i]];
+                        for_each_vertex(pending[i], [&](unsigned int w){
+                            uint64_t current = owner[w].load(std::memory_order_relaxed);
+                            while (p < current && !owner[w].compare_exchange_weak(current, p, std::memory_order_relaxed)) {}
+                        });
+                    }
+                });
+                parallel_chunks(pending.size(), nb_pending_chunks, [&](unsigned int chunk, size_t begin, size_t end){
+                    std::vector<unsigned int> & pass = chunks[chunk].list;
+                    pass.clear();
+                    for (size_t i = begin; i < end; ++i) {
+                        bool owns = true;
+                        for_each_vertex(pending[i], [&](unsigned int w){ owns = owns && owner[w].load(std::memory_order_relaxed) == priorities[pending[i]]; });
+                        if (!owns) continue;
+                        for_each_vertex(pending[i], [&](unsigned int w){ claimed[w] = round; });
+                        pass.push_back(candidates[pending[i]]);
+                    }
+                });
+                for (unsigned int c = 0; c < nb_pending_chunks; ++c) selected.insert(selected.end(), chunks[c].list.begin(), chunks[c].list.end());
+                pending = filter(pending, [&](unsigned int i){
+                    bool free = true;
+                    for_each_vertex(i, [&](unsigned int w){ free = free && claimed[w] != round; });
+                    if (free) for_each_vertex(i, [&](unsigned int w){ owner[w].store(UINT64_MAX, std::memory_order_relaxed); });
+                    return free;
+                });
+            }
+
+            // no more collapses than needed to reach the target, the cheapest first
+            size_t nb_removed = 0;
+            for (unsigned int v : selected) nb_removed += count_triangles(v, m_best[v].target);
+            if (nb_removed > m_nb_triangles - target_triangles) {
+                std::sort(selected.begin(), selected.end(), [&](unsigned int a, unsigned int b){ return priority(a) < priority(b); });
+                size_t kept = 0;
+                nb_removed = 0;
+                while (nb_removed < m_nb_triangles - target_triangles) nb_removed += count_triangles(selected[kept], m_best[selected[kept]].target), ++kept;
+                selected.resize(kept);
+            }
+
+            // room in the pool for the merged lists
+            offsets.resize(selected.size());
+            size_t pool_size = m_pool.size();
+            for (size_t i = 0; i < selected.size(); ++i) {
+                offsets[i] = pool_size;
+                pool_size += m_size[selected[i]] + m_size[m_best[selected[i]].target];
+            }
+            m_pool.resize(pool_size);
+
+            // the collapses touch separate vertices : they and the updates of their neighbours run in parallel
+            removed.assign(selected.size(), NONE);
+            parallel_chunks(selected.size(), parallel_nb_chunks(selected.size(), 1 << 6), [&](unsigned int chunk, size_t begin, size_t end){
+                Scratch & scratch = chunks[chunk].scratch;
+                for (size_t i = begin; i < end; ++i) {
+                    const unsigned int v = selected[i], x = m_best[v].target;
+                    if (!can_collapse(v, x, m_best[v].position, scratch)) {
+                        dirty[v] = REFUSED;
+                        continue;
+                    }
+                    removed[i] = merge(v, x, m_best[v].position, offsets[i]);
+                    dirty[x] = STALE;
+                    gather_ring(x, scratch.ring);
+                    for (unsigned int n : scratch.ring) {
+                        if (m_best[n].target == NONE) dirty[n] = REFUSED;
+                        else if (m_best[n].target == v || m_best[n].target == x) dirty[n] = std::max(dirty[n], (unsigned char) STALE);
+                    }
+                }
+            });
+            unsigned int nb_collapses = 0;
+            for (unsigned int r : removed) {
+                if (r == NONE) continue;
+                m_nb_triangles -= r;
+                ++nb_collapses;
+            }
+            rounds.push_back(nb_collapses);
+
+            active = filter(active, [&](unsigned int v){ return m_size[v] > 0; });
+            if (m_pool.size() > 2 * m_initial_pool) compact_pool();
+        }
+        return rounds;
+    }
+
+    // vertices referenced by the remaining triangles, in increasing order, and the remaining triangles
+    void result (std::vector<glm::vec3> & vertices, std::vector<mesh_index> & indices) const {
+        std::vector<unsigned int> remap(m_positions.size(), NONE);
+        for (size_t t = 0; t < m_triangle_removed.size(); ++t) {
+            if (m_triangle_removed[t]) continue;
+            for (short c = 0; c < 3; ++c) remap[m_triangles[3 * t + c]] = 0;
+        }
+        vertices.clear();
+        for (unsigned int v = 0; v < remap.size(); ++v) {
+            if (remap[v] == NONE) continue;
+            remap[v] = (unsigned int) vertices.size();
+            vertices.push_back(m_positions[v]);
+        }
+        indices.clear();
+        indices.reserve(3 * m_nb_triangles);
+        for (size_t t = 0; t < m_triangle_removed.size(); ++t) {
+            if (m_triangle_removed[t]) continue;
+            for (short c = 0; c < 3; ++c) indices.push_back((mesh_index) remap[m_triangles[3 * t + c]]);
+        }
+    }
+
+    // remaining triangles appended to indices, into vertices shared by several states of the mesh : slot[v] is
+    // the entry of v in vertices (NONE at first), v gets a new entry when it has moved since it was appended
+    void append_level (std::vector<glm::vec3> & vertices, std::vector<mesh_index> & indices, std::vector<unsigned int> & slot) const {
+        indices.reserve(indices.size() + 3 * m_nb_triangles);
+        for (size_t t = 0; t < m_triangle_removed.size(); ++t) {
+            if (m_triangle_removed[t]) continue;
+            for (short c = 0; c < 3; ++c) {
+                const unsigned int v = m_triangles[3 * t + c];
+                if (slot[v] == NONE || vertices[slot[v]] != m_positions[v]) {
+                    slot[v] = (unsigned int) vertices.size();
+                    vertices.push_back(m_positions[v]);
+                }
+                indices.push_back((mesh_index) slot[v]);
+            }
+        }
+    }
+
+    [[nodiscard]] size_t getNumberOfTriangles () const { return m_nb_triangles; }
+
+    // keep the changes of each collapse applied by run (the rounds of run_parallel aren't recorded)
+    void record_collapses () { m_recording = true; }
+
+    // progressive mesh undoing the recorded collapses : the vertices of the triangles that remain, in increasing
+    // order, then one vertex per split, and the remaining triangles then the triangles removed by each collapse,
+    // the last collapse first. Each triangle keeps the vertices it had when it was removed
+    void progressive (ProgressiveMesh & pm) const {
+        const size_t nb_vertices = m_positions.size(), nb_triangles = m_triangle_removed.size();
+
+        // vertices never collapsed that a triangle used
+        std::vector<unsigned int> id(nb_vertices, NONE);
+        for (unsigned int v : m_triangles) id[v] = 0;
+        for (const Collapse & collapse : m_collapses) id[collapse.v] = NONE;
+        pm = ProgressiveMesh();
+        for (unsigned int v = 0; v < nb_vertices; ++v) {
+            if (id[v] == NONE) continue;
+            id[v] = (unsigned int) pm.vertices.size();
+            pm.vertices.push_back(m_positions[v]);
+        }
+        pm.nb_base_vertices = (unsigned int) pm.vertices.size();
+
+        std::vector<unsigned int> face(nb_triangles, NONE);
+        unsigned int nb_faces = 0;
+        for (size_t t = 0; t < nb_triangles; ++t) if (!m_triangle_removed[t]) face[t] = nb_faces++;
+        pm.nb_base_triangles = nb_faces;
+        for (size_t i = m_collapses.size(); i-- > 0;) {
+            const Collapse & collapse = m_collapses[i];
+            id[collapse.v] = (unsigned int) pm.vertices.size();
+            pm.vertices.push_back(collapse.v_position);
+            const size_t begin = i == 0 ? 0 : m_collapses[i - 1].removed_end;
+            for (size_t r = begin; r < collapse.removed_end; ++r) face[m_removed[r]] = nb_faces++;
+        }
+
+        pm.indices.resize(3 * nb_triangles);
+        for (size_t t = 0; t < nb_triangles; ++t) {
+            for (short c = 0; c < 3; ++c) pm.indices[3 * face[t] + c] = (mesh_index) id[m_triangles[3 * t + c]];
+        }
+
+        pm.splits.reserve(m_collapses.size());
+        pm.corners.reserve(m_corners.size());
+        unsigned int triangle_end = pm.nb_base_triangles;
+        for (size_t i = m_collapses.size(); i-- > 0;) {
+            const Collapse & collapse = m_collapses[i];
+            triangle_end += (unsigned int) (collapse.removed_end - (i == 0 ? 0 : m_collapses[i - 1].removed_end));
+            for (size_t r = i == 0 ? 0 : m_collapses[i - 1].corner_end; r < collapse.corner_end; ++r) {
+                pm.corners.push_back(3 * face[m_corners[r] / 3] + m_corners[r] % 3);
+            }
+            pm.splits.push_back(ProgressiveMesh::VertexSplit{id[collapse.x], triangle_end, (unsigned int) pm.corners.size(),
+                                                              collapse.x_position, collapse.position});
+        }
+    }
+
+private:
+    struct Candidate {
+        double cost;
+        unsigned int target;
+        glm::vec3 position;
+    };
+
+    // lists reused by the evaluations of one thread
+    struct Scratch {
+        std::vector<unsigned int> ring, other_ring;
+        std::vector<Candidate> candidates;
+    };
+
+    [[nodiscard]] glm::dvec3 triangle_normal (unsigned int t) const {
+        const glm::dvec3 a(m_positions[m_triangles[3 * t]]), b(m_positions[m_triangles[3 * t + 1]]), c(m_positions[m_triangles[3 * t + 2]]);
+        return glm::cross(b - a, c - a);
+    }
+
+    [[nodiscard]] bool contains (unsigned int t, unsigned int v) const {
+        return m_triangles[3 * t] == v || m_triangles[3 * t + 1] == v || m_triangles[3 * t + 2] == v;
+    }
+
+    // number of remaining triangles around v containing x
+    [[nodiscard]] unsigned int count_triangles (unsigned int v, unsigned int x) const {
+        unsigned int count = 0;
+        for (unsigned int i = 0; i < m_size[v]; ++i) {
+            const unsigned int t = m_pool[m_start[v] + i];
+            if (!m_triangle_removed[t] && contains(t, x)) ++count;
+        }
+        return count;
+    }
+
+    // the other vertices of the remaining triangles around v, once per triangle
+    void gather_ring (unsigned int v, std::vector<unsigned int> & ring) const {
+        ring.clear();
+        for (unsigned int i = 0; i < m_size[v]; ++i) {
+            const unsigned int t = m_pool[m_start[v] + i];
+            if (m_triangle_removed[t]) continue;
+            for (short c = 0; c < 3; ++c) if (m_triangles[3 * t + c] != v) ring.push_back(m_triangles[3 * t + c]);
+        }
+        std::sort(ring.begin(), ring.end());
+    }
+
+    // collapse of v into x at the minimum of their summed quadrics, or at the best of the two ends and the
+    // middle of the edge when it isn't unique
+    [[nodiscard]] Candidate evaluate (unsigned int v, unsigned int x) const {
+        const Quadric q = m_quadrics[v] + m_quadrics[x];
+        glm::vec3 position;
+        if (!q.minimise(position)) {
+            const glm::vec3 choices[3] = {m_positions[v], m_positions[x], (m_positions[v] + m_positions[x]) / 2.0f};
+            position = choices[0];
+            for (const glm::vec3 & choice : choices) if (q.evaluate(choice) < q.evaluate(position)) position = choice;
+        }
+        return Candidate{std::max(0.0, q.evaluate(position)), x, position};
+    }
+
+    [[nodiscard]] static bool cheaper (const Candidate & a, const Candidate & b) {
+        return a.cost < b.cost || (a.cost == b.cost && a.target < b.target);
+    }
+
+    // cheapest collapse of v into one of its neighbours, target is NONE when v has none
+    Candidate best_collapse (unsigned int v, std::vector<unsigned int> & ring) const {
+        gather_ring(v, ring);
+        Candidate best{std::numeric_limits<double>::infinity(), NONE, glm::vec3(0.0f)};
+        for (size_t i = 0; i < ring.size(); ++i) {
+            if (i > 0 && ring[i - 1] == ring[i]) continue;
+            const Candidate candidate = evaluate(v, ring[i]);
+            if (best.target == NONE || cheaper(candidate, best)) best = candidate;
+        }
+        return best;
+    }
+
+    // elements of list satisfying keep, in the order of list
+    template <typename F>
+    static std::vector<unsigned int> filter (const std::vector<unsigned int> & list, F && keep) {
+        const unsigned int nb_chunks = parallel_nb_chunks(list.size(), 1 << 10);
+        std::vector<std::vector<unsigned int>> chunk_kept(nb_chunks);
+        parallel_chunks(list.size(), nb_chunks, [&](unsigned int chunk, size_t begin, size_t end){
+            for (size_t i = begin; i < end; ++i) if (keep(list[i])) chunk_kept[chunk].push_back(list[i]);
+        });
+        std::vector<unsigned int> kept;
+        for (const std::vector<unsigned int> & chunk : chunk_kept) kept.insert(kept.end(), chunk.begin(), chunk.end());
+        return kept;
+    }
+
+    // cheapest collapse of v passing the checks of can_collapse, target is NONE when v has none
+    Candidate best_valid_collapse (unsigned int v, Scratch & scratch) const {
+        rank_collapses(v, scratch.ring, scratch.candidates);
+        for (const Candidate & candidate : scratch.candidates) {
+            if (can_collapse(v, candidate.target, candidate.position, scratch)) return candidate;
+        }
+        return Candidate{std::numeric_limits<double>::infinity(), NONE, glm::vec3(0.0f)};
+    }
+
+    // f(w) for the vertices of the remaining triangles around v and x (some of them several times)
+    template <typename F>
+    void for_each_touched (unsigned int v, unsigned int x, F && f) const {
+        for (unsigned int end : {v, x}) {
+            for (unsigned int i = 0; i < m_size[end]; ++i) {
+                const unsigned int t = m_pool[m_start[end] + i];
+                if (m_triangle_removed[t]) continue;
+                for (short c = 0; c < 3; ++c) f(m_triangles[3 * t + c]);
+            }
+        }
+    }
+
+    // collapses of v into each of its neighbours by increasing cost
+    void rank_collapses (unsigned int v, std::vector<unsigned int> & ring, std::vector<Candidate> & candidates) const {
+        gather_ring(v, ring);
+        candidates.clear();
+        for (size_t i = 0; i < ring.size(); ++i) {
+            if (i > 0 && ring[i - 1] == ring[i]) continue;
+            candidates.push_back(evaluate(v, ring[i]));
+        }
+        std::sort(candidates.begin(), candidates.end(), cheaper);
+    }
+
+    // link condition (the common neighbours of v and x are the opposite vertices of their common triangles,
+    // and an inner edge doesn't join two boundary vertices), and no triangle turns over or degenerates
+    bool can_collapse (unsigned int v, unsigned int x, glm::vec3 position, Scratch & scratch) const {
+        const std::vector<unsigned int> & v_ring = scratch.ring, & x_ring = scratch.other_ring;
+        gather_ring(v, scratch.ring);
+        gather_ring(x, scratch.other_ring);
+        const unsigned int shared = count_triangles(v, x);
+
+        // a neighbour seen in a single triangle is the other end of a boundary edge
+        bool v_boundary = false, x_boundary = false;
+        unsigned int common = 0;
+        for (size_t i = 0, j = 0; i < v_ring.size(); ++i) {
+            if (i > 0 && v_ring[i - 1] == v_ring[i]) continue;
+            const unsigned int n = v_ring[i];
+            if ((i + 1 == v_ring.size() || v_ring[i + 1] != n)) v_boundary = true;
+            while (j < x_ring.size() && x_ring[j] < n) ++j;
+            if (n != x && j < x_ring.size() && x_ring[j] == n) ++common;
+        }
+        for (size_t i = 0; i < x_ring.size(); ++i) {
+            if ((i == 0 || x_ring[i - 1] != x_ring[i]) && (i + 1 == x_ring.size() || x_ring[i + 1] != x_ring[i])) {
+                x_boundary = true;
+                break;
+            }
+        }
+        if (shared == 0 || common != shared) return false;
+        if (shared == 2 && v_boundary && x_boundary) return false;
+
+        // a component made of the triangles around the edge only (a tetrahedron, a lone triangle) would fold
+        // into coincident triangles : v and x need a neighbour other than the opposite vertices of the edge
+        unsigned int others = 0;
+        for (size_t i = 0, j = 0; i < v_ring.size() || j < x_ring.size();) {
+            const unsigned int n = j == x_ring.size() || (i < v_ring.size() && v_ring[i] < x_ring[j]) ? v_ring[i] : x_ring[j];
+            while (i < v_ring.size() && v_ring[i] == n) ++i;
+            while (j < x_ring.size() && x_ring[j] == n) ++j;
+            if (n != v && n != x) ++others;
+        }
+        if (others == common) return false;
+
+        // a triangle of v moved to x must not be a triangle x already has
+        for (unsigned int i = 0; i < m_size[v]; ++i) {
+            const unsigned int t = m_pool[m_start[v] + i];
+            if (m_triangle_removed[t] || contains(t, x)) continue;
+            unsigned int a = NONE, b = NONE;
+            for (short c = 0; c < 3; ++c) {
+                const unsigned int w = m_triangles[3 * t + c];
+                if (w != v) (a == NONE ? a : b) = w;
+            }
+            for (unsigned int k = 0; k < m_size[x]; ++k) {
+                const unsigned int u = m_pool[m_start[x] + k];
+                if (!m_triangle_removed[u] && contains(u, a) && contains(u, b)) return false;
+            }
+        }
+
+        // triangles moved by the collapse keep their orientation
+        for (unsigned int end = 0; end < 2; ++end) {
+            const unsigned int moved = end == 0 ? v : x, other = end == 0 ? x : v;
+            for (unsigned int i = 0; i < m_size[moved]; ++i) {
+                const unsigned int t = m_pool[m_start[moved] + i];
+                if (m_triangle_removed[t] || contains(t, other)) continue;
+                glm::dvec3 corners[3];
+                for (short c = 0; c < 3; ++c) {
+                    const unsigned int w = m_triangles[3 * t + c];
+                    corners[c] = glm::dvec3(w == moved ? position : m_positions[w]);
+                }
+                const glm::dvec3 before = triangle_normal(t), after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                const double lengths = glm::length(before) * glm::length(after);
+                if (lengths == 0.0 || glm::dot(before, after) < MIN_NORMAL_COSINE * lengths) return false;
+            }
+        }
+        return true;
+    }
+
+    // merge v into x at position, the triangle list of x is written at m_pool[start], which has room for the
+    // lists of v and x. Touches only the vertices of the triangles around v and x. Returns the number of
+    // triangles removed
+    unsigned int merge (unsigned int v, unsigned int x, glm::vec3 position, size_t start) {
+        // the triangles of the edge disappear, the other triangles of v now use x
+        unsigned int removed = 0;
+        size_t end = start;
+        for (unsigned int i = 0; i < m_size[x]; ++i) {
+            const unsigned int t = m_pool[m_start[x] + i];
+            if (!m_triangle_removed[t] && contains(t, v)) { m_triangle_removed[t] = 1; ++removed; }
+            if (!m_triangle_removed[t]) m_pool[end++] = t;
+        }
+        for (unsigned int i = 0; i < m_size[v]; ++i) {
+            const unsigned int t = m_pool[m_start[v] + i];
+            if (m_triangle_removed[t]) continue;
+            for (short c = 0; c < 3; ++c) if (m_triangles[3 * t + c] == v) m_triangles[3 * t + c] = x;
+            m_pool[end++] = t;
+        }
+        m_start[x] = (unsigned int) start;
+        m_size[x] = (unsigned int) (end - start);
+        m_size[v] = 0;
+
+        m_positions[x] = position;
+        m_quadrics[x] += m_quadrics[v];
+        return removed;
+    }
+
+    // what the merge of v into x at position will change : the triangles of the edge and the corners of v in
+    // its other triangles
+    void record (unsigned int v, unsigned int x, glm::vec3 position) {
+        for (unsigned int i = 0; i < m_size[x]; ++i) {
+            const unsigned int t = m_pool[m_start[x] + i];
+            if (!m_triangle_removed[t] && contains(t, v)) m_removed.push_back(t);
+        }
+        for (unsigned int i = 0; i < m_size[v]; ++i) {
+            const unsigned int t = m_pool[m_start[v] + i];
+            if (m_triangle_removed[t] || contains(t, x)) continue;
+            for (short c = 0; c < 3; ++c) if (m_triangles[3 * t + c] == v) m_corners.push_back(3 * t + c);
+        }
+        m_collapses.push_back(Collapse{v, x, m_positions[v], m_positions[x], position, m_removed.size(), m_corners.size()});
+    }
+
+    // merge v into x at position and update the heap
+    void apply (unsigned int v, unsigned int x, glm::vec3 position, double cost) {
+        if (m_recording) record(v, x, position);
+        const size_t start = m_pool.size();
+        m_pool.resize(start + m_size[x] + m_size[v]);
+        m_nb_triangles -= merge(v, x, position, start);
+        m_pool.resize(start + m_size[x]);
+        m_heap.remove(v);
+
+        // x is evaluated again. The other edges of a neighbour are unchanged and its edge to x only costs more :
+        // its key stays exact unless its cheapest collapse was into v or x, it is then a lower bound evaluated
+        // again when it reaches the top. Neighbours without a valid collapse get another chance
+        const Candidate best = best_collapse(x, m_scratch.ring);
+        m_best[x] = Best{best.target, best.position};
+        if (best.target == NONE) m_heap.remove(x);
+        else m_heap.update(x, std::max(cost, best.cost));
+        gather_ring(x, m_scratch.other_ring);
+        for (unsigned int n : m_scratch.other_ring) {
+            if (m_heap.contains(n) && m_best[n].target != v && m_best[n].target != x) continue;
+            m_best[n].target = NONE;
+            if (!m_heap.contains(n)) m_heap.update(n, cost);
+        }
+
+        if (m_pool.size() > 2 * m_initial_pool) compact_pool();
+    }
+
+    // rewrite the triangle lists of the remaining vertices at the beginning of the pool
+    void compact_pool () {
+        std::vector<unsigned int> pool;
+        pool.reserve(m_initial_pool);
+        for (unsigned int v = 0; v < m_start.size(); ++v) {
+            const unsigned int start = (unsigned int) pool.size();
+            for (unsigned int i = 0; i < m_size[v]; ++i) {
+                const unsigned int t = m_pool[m_start[v] + i];
+                if (!m_triangle_removed[t]) pool.push_back(t);
+            }
+            m_start[v] = start;
+            m_size[v] = (unsigned int) pool.size() - start;
+        }
+        m_pool.swap(pool);
+    }
+
+    std::vector<glm::vec3> m_positions;
+    std::vector<unsigned int> m_triangles;
+    std::vector<Quadric> m_quadrics;
+    std::vector<unsigned char> m_triangle_removed;
+    size_t m_nb_triangles = 0;
+
+    // triangles around v : m_pool[m_start[v]] ... m_pool[m_start[v] + m_size[v] - 1], some of them removed
+    std::vector<unsigned int> m_pool, m_start, m_size;
+    size_t m_initial_pool = 0;
+
+    // cheapest collapse of each vertex in the heap, its cost is the key. The target is NONE when the key
+    // is only a lower bound
+    struct Best {
+        unsigned int target;
+        glm::vec3 position;
+    };
+    std::vector<Best> m_best;
+    IndexedHeap m_heap;
+    bool m_heap_built = false;
+    // scratch lists of run, reused by every collapse
+    Scratch m_scratch;
+
+    // collapses applied by run in their order when recording : the triangles removed by collapse i are
+    // m_removed[m_collapses[i - 1].removed_end] ... m_removed[m_collapses[i].removed_end - 1], and the same
+    // in m_corners for the corners of v moved to x
+    struct Collapse {
+        unsigned int v, x;
+        glm::vec3 v_position, x_position;       // before the collapse
+        glm::vec3 position;                     // of x after the collapse
+        size_t removed_end, corner_end;
+    };
+    bool m_recording = false;
+    std::vector<Collapse> m_collapses;
+    std::vector<unsigned int> m_removed, m_corners;
+};
+
+} // namespace
+
+void Mesh::decimate (unsigned int target_triangles, double max_error)
+{
+    if (getNumberOfTriangles() <= target_triangles) return;
+
+    EdgeCollapse collapse(indexed_vertices, indices, adjacency());
+    collapse.run(target_triangles, max_error);
+
+    std::vector<glm::vec3> repr_indexed_vertices;
+    std::vector<mesh_index> repr_indices;
+    collapse.result(repr_indexed_vertices, repr_indices);
+
+    // we substitute old vectors with new one, normals are computed again on the new triangles
+    indices.swap(repr_indices);
+    indexed_vertices.swap(repr_indexed_vertices);
+    clear_caches();
+    compute_smooth_vertex_normals<UniformWeight>();
+}
+
+std::vector<unsigned int> Mesh::decimateParallel (unsigned int target_triangles, double max_error)
+{
+    if (getNumberOfTriangles() <= target_triangles) return {};
+
+    EdgeCollapse collapse(indexed_vertices, indices, adjacency());
+    std::vector<unsigned int> rounds = collapse.run_parallel(target_triangles, max_error);
+
+    std::vector<glm::vec3> repr_indexed_vertices;
+    std::vector<mesh_index> repr_indices;
+    collapse.result(repr_indexed_vertices, repr_indices);
+
+    // we substitute old vectors with new one, normals are computed again on the new triangles
+    indices.swap(repr_indices);
+    indexed_vertices.swap(repr_indexed_vertices);
+    clear_caches();
+    compute_smooth_vertex_normals<UniformWeight>();
+    return rounds;
+}
+
+LODChain Mesh::buildLODChain (unsigned int nb_levels, float ratio)
+{
+    LODChain chain;
+    // written so that NaN is refused too
+    if (!(ratio > 0.0f && ratio < 1.0f)) {
+        std::cerr << "ratio " << ratio << " of the levels of detail is not in ]0, 1[" << std::endl;
+        return chain;
+    }
+    if (nb_levels == 0 || getNumberOfTriangles() == 0) return chain;
+
+    // each level continues the collapses of the previous one, the vertices it didn't move are shared
+    EdgeCollapse collapse(indexed_vertices, indices, adjacency());
+    std::vector<unsigned int> slot(indexed_vertices.size(), NONE);
+    double target = getNumberOfTriangles();
+    chain.level_start.push_back(0);
+    for (unsigned int level = 0; level < nb_levels; ++level) {
+        if (level > 0) {
+            target *= ratio;
+            collapse.run((unsigned int) target, std::numeric_limits<double>::infinity());
+        }
+        collapse.append_level(chain.vertices, chain.indices, slot);
+        chain.level_start.push_back(chain.indices.size());
+    }
+
+    if (chain.vertices.size() - 1 > std::numeric_limits<mesh_index>::max()) {
+        std::cerr << chain.vertices.size() << " vertices of the levels don't fit in " << sizeof(mesh_index) * 8 << "-bit indices" << std::endl;
+        return LODChain();
+    }
+    return chain;
+}
+
+void LODChain::extract (unsigned int level, Mesh & mesh) const
+{
+    // the vertices of the level in their order
+    std::vector<unsigned int> remap(vertices.size(), NONE);
+    for (size_t i = level_start[level]; i < level_start[level + 1]; ++i) remap[indices[i]] = 0;
+
+    mesh = Mesh();
+    glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+    for (unsigned int v = 0; v < remap.size(); ++v) {
+        if (remap[v] == NONE) continue;
+        remap[v] = (unsigned int) mesh.indexed_vertices.size();
+        mesh.indexed_vertices.push_back(vertices[v]);
+        min = glm::min(min, vertices[v]);
+        max = glm::max(max, vertices[v]);
+    }
+    mesh.indices.reserve(level_start[level + 1] - level_start[level]);
+    for (size_t i = level_start[level]; i < level_start[level + 1]; ++i) mesh.indices.push_back((mesh_index) remap[indices[i]]);
+
+    if (!mesh.indexed_vertices.empty()) {
+        mesh.bounding_box.xpos = glm::vec2(min.x, max.x);
+        mesh.bounding_box.ypos = glm::vec2(min.y, max.y);
+        mesh.bounding_box.zpos = glm::vec2(min.z, max.z);
+    }
+    mesh.indexed_uvs.resize(mesh.indexed_vertices.size(), glm::vec2(1.));
+    mesh.compute_smooth_vertex_normals<UniformWeight>();
+}
+
+ProgressiveMesh Mesh::buildProgressiveMesh (unsigned int base_triangles)
+{
+    ProgressiveMesh pm;
+    EdgeCollapse collapse(indexed_vertices, indices, adjacency());
+    collapse.record_collapses();
+    collapse.run(base_triangles, std::numeric_limits<double>::infinity());
+    collapse.progressive(pm);
+    return pm;
+}
+
+void ProgressiveMesh::setNumberOfVertices (unsigned int nb_vertices)
+{
+    const unsigned int target = std::min(std::max(nb_vertices, nb_base_vertices) - nb_base_vertices, (unsigned int) splits.size());
+
+    // a split moves parent and gives its corners to the new vertex, undoing it gives them back
+    for (; nb_applied < target; ++nb_applied) {
+        const VertexSplit & split = splits[nb_applied];
+        const unsigned int begin = nb_applied == 0 ? 0 : splits[nb_applied - 1].corner_end;
+        vertices[split.parent] = split.parent_position;
+        for (unsigned int i = begin; i < split.corner_end; ++i) indices[corners[i]] = (mesh_index) (nb_base_vertices + nb_applied);
+    }
+    for (; nb_applied > target; --nb_applied) {
+        const VertexSplit & split = splits[nb_applied - 1];
+        const unsigned int begin = nb_applied == 1 ? 0 : splits[nb_applied - 2].corner_end;
+        vertices[split.parent] = split.collapsed_position;
+        for (unsigned int i = begin; i < split.corner_end; ++i) indices[corners[i]] = (mesh_index) split.parent;
+    }
+}
+
+void ProgressiveMesh::extract (Mesh & mesh) const
+{
+    mesh = Mesh();
+    mesh.indexed_vertices.assign(vertices.begin(), vertices.begin() + getNumberOfVertices());
+    mesh.indices.assign(indices.begin(), indices.begin() + 3 * (size_t) getNumberOfTriangles());
+
+    glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+    for (const glm::vec3 & p : mesh.indexed_vertices) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    if (!mesh.indexed_vertices.empty()) {
+        mesh.bounding_box.xpos = glm::vec2(min.x, max.x);
+        mesh.bounding_box.ypos = glm::vec2(min.y, max.y);
+        mesh.bounding_box.zpos = glm::vec2(min.z, max.z);
+    }
+    mesh.indexed_uvs.resize(mesh.indexed_vertices.size(), glm::vec2(1.));
+    mesh.compute_smooth_vertex_normals<UniformWeight>();
+}
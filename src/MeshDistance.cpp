@@ -0,0 +1,170 @@
+#include "MeshDistance.hpp"
+#include "Parallel.hpp"
+
+#include <cmath>
+#include <limits>
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// constructor : bins of the triangles in compressed sparse row form, like MeshAdjacency
+
+MeshDistance::MeshDistance(const Mesh & mesh)
+{
+    const unsigned int nb_triangles = mesh.getNumberOfTriangles();
+    if (nb_triangles == 0) return;
+
+    m_corners.resize(3 * (size_t) nb_triangles);
+    parallel_for(m_corners.size(), 1 << 14, [&](size_t c){ m_corners[c] = mesh.indexed_vertices[mesh.indices[c]]; });
+
+    glm::vec3 max = m_corners[0];
+    m_min = m_corners[0];
+    for (const glm::vec3 & p : m_corners)
+    {
+        m_min = glm::min(m_min, p);
+        max = glm::max(max, p);
+    }
+
+    // cells are cubes of about the volume of the box divided by the number of triangles,
+    // flat axes are given a small thickness
+    glm::vec3 extent = max - m_min;
+    float diagonal = glm::length(extent);
+    extent = glm::max(extent, glm::vec3(diagonal > 0.0f ? 1e-3f * diagonal : 1.0f));
+    const float size = std::cbrt(extent.x * extent.y * extent.z / (float) nb_triangles);
+    for (int a = 0; a < 3; ++a)
+    {
+        m_resolution[a] = std::max(1, std::min((int) std::ceil(extent[a] / size), 1024));
+        m_cell_size[a] = extent[a] / (float) m_resolution[a];
+    }
+
+    // cells overlapped by the box of each triangle
+    auto cell = [&](glm::vec3 p){
+        return glm::clamp(glm::ivec3(glm::floor((p - m_min) / m_cell_size)), glm::ivec3(0), m_resolution - 1);
+    };
+    std::vector<glm::ivec3> triangle_cells(2 * (size_t) nb_triangles);
+    parallel_for(nb_triangles, 1 << 12, [&](size_t t){
+        const glm::vec3 & a = m_corners[3 * t], & b = m_corners[3 * t + 1], & c = m_corners[3 * t + 2];
+        triangle_cells[2 * t] = cell(glm::min(a, glm::min(b, c)));
+        triangle_cells[2 * t + 1] = cell(glm::max(a, glm::max(b, c)));
+    });
+
+    // counting pass then filling pass
+    const size_t nb_cells = (size_t) m_resolution.x * m_resolution.y * m_resolution.z;
+    m_cell_start.assign(nb_cells + 1, 0);
+    auto for_each_cell = [&](unsigned int t, auto && f){
+        const glm::ivec3 & lo = triangle_cells[2 * t], & hi = triangle_cells[2 * t + 1];
+        for (int z = lo.z; z <= hi.z; ++z)
+            for (int y = lo.y; y <= hi.y; ++y)
+                for (int x = lo.x; x <= hi.x; ++x) f(x + m_resolution.x * ((size_t) y + m_resolution.y * (size_t) z));
+    };
+    for (unsigned int t = 0; t < nb_triangles; ++t) for_each_cell(t, [&](size_t c){ ++m_cell_start[c + 1]; });
+    for (size_t c = 0; c < nb_cells; ++c) m_cell_start[c + 1] += m_cell_start[c];
+    m_cell_triangles.resize(m_cell_start[nb_cells]);
+    std::vector<unsigned int> cursor(m_cell_start.begin(), m_cell_start.end() - 1);
+    for (unsigned int t = 0; t < nb_triangles; ++t) for_each_cell(t, [&](size_t c){ m_cell_triangles[cursor[c]++] = t; });
+}
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// queries
+
+float MeshDistance::distance(glm::vec3 p) const
+{
+    if (m_corners.empty()) return std::numeric_limits<float>::infinity();
+
+    // q is the closest point of the grid box : |p - x|^2 >= |p - q|^2 + |q - x|^2 for x in the box
+    const glm::vec3 max = m_min + m_cell_size * glm::vec3(m_resolution);
+    const glm::vec3 q = glm::clamp(p, m_min, max);
+    const float outside = glm::dot(p - q, p - q);
+    const glm::ivec3 center = glm::clamp(glm::ivec3(glm::floor((q - m_min) / m_cell_size)), glm::ivec3(0), m_resolution - 1);
+    const float cell_size = std::min(m_cell_size.x, std::min(m_cell_size.y, m_cell_size.z));
+    const int max_ring = std::max({center.x, center.y, center.z, m_resolution.x - 1 - center.x,
+                                   m_resolution.y - 1 - center.y, m_resolution.z - 1 - center.z});
+
+    float best = std::numeric_limits<float>::infinity();
+    for (int r = 0; r <= max_ring; ++r)
+    {
+        // cells at Chebyshev distance r from the center
+        for (int z = std::max(center.z - r, 0); z <= std::min(center.z + r, m_resolution.z - 1); ++z)
+        {
+            for (int y = std::max(center.y - r, 0); y <= std::min(center.y + r, m_resolution.y - 1); ++y)
+            {
+                const bool face = std::abs(z - center.z) == r || std::abs(y - center.y) == r;
+                const int step = face || r == 0 ? 1 : 2 * r;
+                for (int x = center.x - r; x <= center.x + r; x += step)
+                {
+                    if (x < 0 || x >= m_resolution.x) continue;
+                    const size_t c = x + m_resolution.x * ((size_t) y + m_resolution.y * (size_t) z);
+                    for (unsigned int i = m_cell_start[c]; i < m_cell_start[c + 1]; ++i)
+                    {
+                        best = std::min(best, squared_distance(p, m_cell_triangles[i]));
+                    }
+                }
+            }
+        }
+        // the cells of the next rings are at least r cells away from q
+        const float bound = r * cell_size;
+        if (best <= outside + bound * bound) break;
+    }
+    return std::sqrt(best);
+}
+
+float MeshDistance::max_distance(const Mesh & mesh) const
+{
+    const unsigned int nb_triangles = mesh.getNumberOfTriangles();
+    const unsigned int nb_chunks = parallel_nb_chunks(nb_triangles, 1 << 10);
+    std::vector<float> chunk_max(nb_chunks, 0.0f);
+    parallel_chunks(nb_triangles, nb_chunks, [&](unsigned int chunk, size_t begin, size_t end){
+        for (size_t t = begin; t < end; ++t)
+        {
+            Triangle triangle = mesh.triangle((unsigned int) t);
+            const glm::vec3 & a = mesh.indexed_vertices[triangle[0]], & b = mesh.indexed_vertices[triangle[1]],
+                            & c = mesh.indexed_vertices[triangle[2]];
+            const glm::vec3 samples[7] = {a, b, c, 0.5f * (a + b), 0.5f * (b + c), 0.5f * (c + a), (a + b + c) / 3.0f};
+            for (const glm::vec3 & p : samples) chunk_max[chunk] = std::max(chunk_max[chunk], distance(p));
+        }
+    });
+    float result = 0.0f;
+    for (float d : chunk_max) result = std::max(result, d);
+    return result;
+}
+
+float MeshDistance::hausdorff(const Mesh & a, const Mesh & b)
+{
+    return std::max(MeshDistance(b).max_distance(a), MeshDistance(a).max_distance(b));
+}
+
+// closest point of the triangle by its Voronoi regions (Ericson, Real-Time Collision Detection 5.1.5)
+float MeshDistance::squared_distance(glm::vec3 p, unsigned int t) const
+{
+    const glm::vec3 & a = m_corners[3 * t], & b = m_corners[3 * t + 1], & c = m_corners[3 * t + 2];
+    const glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+    auto squared = [&](glm::vec3 x){ return glm::dot(p - x, p - x); };
+
+    const float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) return squared(a);
+
+    const glm::vec3 bp = p - b;
+    const float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) return squared(b);
+
+    const float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return squared(a + ab * (d1 / (d1 - d3)));
+
+    const glm::vec3 cp = p - c;
+    const float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) return squared(c);
+
+    const float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return squared(a + ac * (d2 / (d2 - d6)));
+
+    const float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) return squared(b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))));
+
+    // inside the triangle, degenerate triangles end here with a null denominator
+    const float sum = va + vb + vc;
+    if (sum == 0.0f) return std::min(squared(a), std::min(squared(b), squared(c)));
+    const float v = vb / sum, w = vc / sum;
+    return squared(a + ab * v + ac * w);
+}
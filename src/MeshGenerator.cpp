@@ -0,0 +1,428 @@
+#include "MeshGenerator.hpp"
+#include "Mesh.hpp"
+#include "Parallel.hpp"
+#include "TextParsing.hpp"
+
+#include <cmath>
+#include <limits>
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// random numbers : integer hash of the seed and of the ids, no state shared between threads
+namespace {
+
+// components of the soup are icospheres of this frequency
+const unsigned int SOUP_FREQUENCY = 4;
+const size_t SOUP_VERTICES = 10 * SOUP_FREQUENCY * SOUP_FREQUENCY + 2;
+const size_t SOUP_TRIANGLES = 20 * SOUP_FREQUENCY * SOUP_FREQUENCY;
+
+inline uint32_t hash(uint32_t x)
+{
+    x ^= x >> 16; x *= 0x7feb352dU;
+    x ^= x >> 15; x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+inline uint32_t hash(uint32_t seed, uint64_t a, uint32_t b = 0)
+{
+    return hash(b ^ hash((uint32_t) a ^ hash((uint32_t) (a >> 32) ^ hash(seed))));
+}
+
+// uniform in [0, 1)
+inline float random(uint32_t h)
+{
+    return (h >> 8) * (1.0f / 16777216.0f);
+}
+
+} // namespace
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// constructor
+MeshGenerator::MeshGenerator(Shape shape, size_t nb_triangles, uint32_t seed) : m_shape(shape), m_seed(seed)
+{
+    // icosahedron : the 12 points (0, +-1, +-phi) and their circular permutations, faces are the triples
+    // of corners at distance 2 of each other and edges the pairs
+    const float phi = (1.0f + std::sqrt(5.0f)) / 2.0f;
+    glm::vec3 corners[12];
+    for (unsigned int c = 0; c < 12; ++c)
+    {
+        glm::vec3 p(0.0f, c & 1 ? -1.0f : 1.0f, c & 2 ? -phi : phi);
+        if (c / 4 == 1) p = glm::vec3(p.y, p.z, p.x);
+        if (c / 4 == 2) p = glm::vec3(p.z, p.x, p.y);
+        corners[c] = p;
+        m_corners[c] = glm::normalize(p);
+    }
+    auto adjacent = [&](unsigned int a, unsigned int b){ return std::abs(glm::length(corners[a] - corners[b]) - 2.0f) < 1e-3f; };
+
+    unsigned int nb_edges = 0, nb_faces = 0;
+    for (unsigned int a = 0; a < 12; ++a)
+    {
+        for (unsigned int b = a + 1; b < 12; ++b)
+        {
+            if (!adjacent(a, b)) continue;
+            m_edges[nb_edges][0] = a; m_edges[nb_edges][1] = b; nb_edges++;
+            for (unsigned int c = b + 1; c < 12; ++c)
+            {
+                if (!adjacent(a, c) || !adjacent(b, c)) continue;
+                const bool outward = glm::dot(glm::cross(corners[b] - corners[a], corners[c] - corners[a]), corners[a]) > 0.0f;
+                m_faces[nb_faces][0] = a; m_faces[nb_faces][1] = outward ? b : c; m_faces[nb_faces][2] = outward ? c : b;
+                nb_faces++;
+            }
+        }
+    }
+    for (unsigned int f = 0; f < 20; ++f)
+    {
+        const unsigned int sides[3][2] = {{m_faces[f][0], m_faces[f][1]}, {m_faces[f][0], m_faces[f][2]}, {m_faces[f][1], m_faces[f][2]}};
+        for (unsigned int s = 0; s < 3; ++s)
+        {
+            const unsigned int lo = std::min(sides[s][0], sides[s][1]), hi = std::max(sides[s][0], sides[s][1]);
+            for (unsigned int e = 0; e < 30; ++e)
+            {
+                if (m_edges[e][0] == lo && m_edges[e][1] == hi) m_face_edges[f][s] = e;
+            }
+        }
+    }
+
+    // size of the shape closest to nb_triangles
+    switch (m_shape)
+    {
+        case ICOSPHERE:
+            m_n = std::max(1u, (unsigned int) std::lround(std::sqrt(nb_triangles / 20.0)));
+            m_nb_vertices = 10 * (size_t) m_n * m_n + 2;
+            m_nb_triangles = 20 * (size_t) m_n * m_n;
+            break;
+        case TERRAIN:
+            m_n = std::max(1u, (unsigned int) std::lround(std::sqrt(nb_triangles / 2.0)));
+            m_nb_vertices = ((size_t) m_n + 1) * ((size_t) m_n + 1);
+            m_nb_triangles = 2 * (size_t) m_n * m_n;
+            break;
+        case SOUP:
+        default:
+            m_shape = SOUP;
+            m_n = std::max(1u, (unsigned int) std::lround((double) nb_triangles / SOUP_TRIANGLES));
+            m_nb_vertices = SOUP_VERTICES * m_n;
+            m_nb_triangles = SOUP_TRIANGLES * m_n;
+            break;
+    }
+}
+
+bool MeshGenerator::parse_shape(const std::string & name, Shape & shape)
+{
+    for (Shape s : {ICOSPHERE, TERRAIN, SOUP})
+    {
+        if (name == shape_name(s))
+        {
+            shape = s;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char * MeshGenerator::shape_name(Shape shape)
+{
+    switch (shape)
+    {
+        case ICOSPHERE: return "icosphere";
+        case TERRAIN: return "terrain";
+        default: return "soup";
+    }
+}
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// icosphere of frequency n : point (i, j) of face (a, b, c) is (a (n - i - j) + b i + c j) / n projected
+// on the sphere
+//
+// vertex ids : 12 corners | n - 1 per edge, from its lower corner | (n - 1)(n - 2) / 2 per face, by rows of i
+size_t MeshGenerator::lattice_vertex(unsigned int n, unsigned int f, unsigned int i, unsigned int j) const
+{
+    const unsigned int * face = m_faces[f];
+    unsigned int side, from, k;
+    if (j == 0)
+    {
+        if (i == 0) return face[0];
+        if (i == n) return face[1];
+        side = 0; from = face[0]; k = i;
+    }
+    else if (i == 0)
+    {
+        if (j == n) return face[2];
+        side = 1; from = face[0]; k = j;
+    }
+    else if (i + j == n)
+    {
+        side = 2; from = face[1]; k = j;
+    }
+    else
+    {
+        // rows 1 .. i - 1 hold n - 2, n - 3, ... interior vertices
+        const size_t face_vertices = (size_t) (n - 1) * (n - 2) / 2;
+        const size_t row_start = (size_t) (i - 1) * (n - 1) - (size_t) (i - 1) * i / 2;
+        return 12 + 30 * (size_t) (n - 1) + f * face_vertices + row_start + (j - 1);
+    }
+    const unsigned int e = m_face_edges[f][side];
+    if (m_edges[e][0] != from) k = n - k;
+    return 12 + (size_t) e * (n - 1) + (k - 1);
+}
+
+glm::vec3 MeshGenerator::icosphere_vertex(unsigned int n, size_t v) const
+{
+    if (v < 12) return m_corners[v];
+
+    const size_t edge_vertices = 30 * (size_t) (n - 1);
+    if (v < 12 + edge_vertices)
+    {
+        const size_t e = (v - 12) / (n - 1);
+        const float k = (float) ((v - 12) % (n - 1) + 1);
+        return glm::normalize(m_corners[m_edges[e][0]] * (n - k) + m_corners[m_edges[e][1]] * k);
+    }
+
+    // row i starts at (i - 1)(n - 1) - (i - 1) i / 2 : first guess from the root of this quadratic, then adjusted
+    const size_t face_vertices = (size_t) (n - 1) * (n - 2) / 2;
+    const size_t f = (v - 12 - edge_vertices) / face_vertices, l = (v - 12 - edge_vertices) % face_vertices;
+    auto row_start = [n](size_t r){ return r * (n - 1) - r * (r + 1) / 2; };
+    const double b = 2.0 * n - 3.0;
+    size_t r = (size_t) std::max(0.0, (b - std::sqrt(std::max(0.0, b * b - 8.0 * l))) / 2.0);
+    while (r > 0 && row_start(r) > l) r--;
+    while (row_start(r + 1) <= l) r++;
+    const unsigned int i = (unsigned int) r + 1, j = (unsigned int) (l - row_start(r)) + 1;
+
+    const unsigned int * face = m_faces[f];
+    return glm::normalize(m_corners[face[0]] * (float) (n - i - j) + m_corners[face[1]] * (float) i + m_corners[face[2]] * (float) j);
+}
+
+// triangles of a face by rows of j : row j starts at 2 n j - j^2 and holds n - j triangles (i, j) (i + 1, j) (i, j + 1)
+// then n - j - 1 triangles (i + 1, j) (i + 1, j + 1) (i, j + 1)
+void MeshGenerator::icosphere_triangle(unsigned int n, size_t t, size_t corners[3]) const
+{
+    const size_t face_triangles = (size_t) n * n;
+    const unsigned int f = (unsigned int) (t / face_triangles);
+    const size_t l = t % face_triangles;
+    auto row_start = [n](size_t r){ return 2 * n * r - r * r; };
+    size_t r = (size_t) std::max(0.0, n - std::sqrt(std::max(0.0, (double) n * n - (double) l)));
+    while (r > 0 && row_start(r) > l) r--;
+    while (r + 1 < n && row_start(r + 1) <= l) r++;
+
+    const unsigned int j = (unsigned int) r, k = (unsigned int) (l - row_start(r));
+    if (k < n - j)
+    {
+        corners[0] = lattice_vertex(n, f, k, j);
+        corners[1] = lattice_vertex(n, f, k + 1, j);
+        corners[2] = lattice_vertex(n, f, k, j + 1);
+    }
+    else
+    {
+        const unsigned int i = k - (n - j);
+        corners[0] = lattice_vertex(n, f, i + 1, j);
+        corners[1] = lattice_vertex(n, f, i + 1, j + 1);
+        corners[2] = lattice_vertex(n, f, i, j + 1);
+    }
+}
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// terrain : 8 octaves of value noise, the first one of 4 x 4 cells over [0, 1]^2
+float MeshGenerator::terrain_height(float x, float y) const
+{
+    float height = 0.0f, amplitude = 0.5f, total = 0.0f, frequency = 4.0f;
+    for (uint32_t octave = 0; octave < 8; ++octave)
+    {
+        const float fx = x * frequency, fy = y * frequency;
+        const float cx = std::floor(fx), cy = std::floor(fy);
+        const uint32_t ix = (uint32_t) (int32_t) cx, iy = (uint32_t) (int32_t) cy;
+        // smoothstep interpolation of the random values at the corners of the cell
+        const float sx = (fx - cx) * (fx - cx) * (3.0f - 2.0f * (fx - cx));
+        const float sy = (fy - cy) * (fy - cy) * (3.0f - 2.0f * (fy - cy));
+        const uint32_t seed = m_seed + octave * 0x9e3779b9U;
+        const float v00 = random(hash(seed, ix, iy)), v10 = random(hash(seed, ix + 1, iy));
+        const float v01 = random(hash(seed, ix, iy + 1)), v11 = random(hash(seed, ix + 1, iy + 1));
+        const float v = (v00 + (v10 - v00) * sx) + ((v01 + (v11 - v01) * sx) - (v00 + (v10 - v00) * sx)) * sy;
+        height += amplitude * (2.0f * v - 1.0f);
+        total += amplitude;
+        amplitude *= 0.5f;
+        frequency *= 2.0f;
+    }
+    return height / total;
+}
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// vertices and triangles
+void MeshGenerator::vertex(size_t v, glm::vec3 & position, glm::vec3 & normal) const
+{
+    switch (m_shape)
+    {
+        case ICOSPHERE:
+        {
+            position = normal = icosphere_vertex(m_n, v);
+            break;
+        }
+        case TERRAIN:
+        {
+            // (x, z) in [-1, 1]^2, normal from the central differences of the height
+            const float scale = 0.3f, w = (float) m_n, e = 1.0f / w;
+            const float u = (float) (v % (m_n + 1)) / w, t = (float) (v / (m_n + 1)) / w;
+            position = glm::vec3(2.0f * u - 1.0f, scale * terrain_height(u, t), 2.0f * t - 1.0f);
+            const float du = scale * (terrain_height(u + e, t) - terrain_height(u - e, t)) / (2.0f * e);
+            const float dt = scale * (terrain_height(u, t + e) - terrain_height(u, t - e)) / (2.0f * e);
+            normal = glm::normalize(glm::vec3(-2.0f * du, 4.0f, -2.0f * dt));
+            break;
+        }
+        case SOUP:
+        default:
+        {
+            // component c : sphere of random center in [-1, 1]^3 and radius, the radius of each vertex is noisy
+            const size_t c = v / SOUP_VERTICES;
+            const glm::vec3 center(2.0f * random(hash(m_seed, c, 1)) - 1.0f, 2.0f * random(hash(m_seed, c, 2)) - 1.0f,
+                                   2.0f * random(hash(m_seed, c, 3)) - 1.0f);
+            const float radius = (0.3f + 0.7f * random(hash(m_seed, c, 4))) / std::cbrt((float) m_n);
+            const float noise = 1.0f + 0.2f * (random(hash(m_seed, v, 5)) - 0.5f);
+            normal = icosphere_vertex(SOUP_FREQUENCY, v % SOUP_VERTICES);
+            position = center + radius * noise * normal;
+            break;
+        }
+    }
+}
+
+void MeshGenerator::triangle(size_t t, size_t corners[3]) const
+{
+    switch (m_shape)
+    {
+        case ICOSPHERE:
+        {
+            icosphere_triangle(m_n, t, corners);
+            break;
+        }
+        case TERRAIN:
+        {
+            // cell (x, y) : triangles (a, c, b) and (b, c, d) facing up
+            const size_t cell = t / 2, x = cell % m_n, y = cell / m_n;
+            const size_t a = y * (m_n + 1) + x, b = a + 1, c = a + m_n + 1, d = c + 1;
+            if (t % 2 == 0) { corners[0] = a; corners[1] = c; corners[2] = b; }
+            else { corners[0] = b; corners[1] = c; corners[2] = d; }
+            break;
+        }
+        case SOUP:
+        default:
+        {
+            const size_t first = t / SOUP_TRIANGLES * SOUP_VERTICES;
+            icosphere_triangle(SOUP_FREQUENCY, t % SOUP_TRIANGLES, corners);
+            for (int i = 0; i < 3; ++i) corners[i] += first;
+            break;
+        }
+    }
+}
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// mesh
+bool MeshGenerator::generate(Mesh & mesh) const
+{
+    if (m_nb_vertices - 1 > std::numeric_limits<mesh_index>::max())
+    {
+        std::cerr << m_nb_vertices << " vertices don't fit in " << sizeof(mesh_index) * 8 << "-bit indices" << std::endl;
+        return false;
+    }
+
+    // a fresh mesh : nothing computed for the previous triangles is kept
+    mesh = Mesh();
+    mesh.indexed_vertices.resize(m_nb_vertices);
+    mesh.indexed_normals.resize(m_nb_vertices);
+    mesh.indexed_uvs.resize(m_nb_vertices, glm::vec2(1.));
+    mesh.indices.resize(3 * m_nb_triangles);
+
+    // bounding box of each chunk of vertices, then of the mesh
+    const unsigned int nb_chunks = parallel_nb_chunks(m_nb_vertices, 1 << 14);
+    std::vector<glm::vec3> chunk_min(nb_chunks, glm::vec3(FLT_MAX)), chunk_max(nb_chunks, glm::vec3(-FLT_MAX));
+    parallel_chunks(m_nb_vertices, nb_chunks, [&](unsigned int c, size_t begin, size_t end){
+        for (size_t v = begin; v < end; ++v)
+        {
+            vertex(v, mesh.indexed_vertices[v], mesh.indexed_normals[v]);
+            chunk_min[c] = glm::min(chunk_min[c], mesh.indexed_vertices[v]);
+            chunk_max[c] = glm::max(chunk_max[c], mesh.indexed_vertices[v]);
+        }
+    });
+    glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+    for (unsigned int c = 0; c < nb_chunks; ++c)
+    {
+        min = glm::min(min, chunk_min[c]);
+        max = glm::max(max, chunk_max[c]);
+    }
+    mesh.bounding_box.xpos = glm::vec2(min.x, max.x);
+    mesh.bounding_box.ypos = glm::vec2(min.y, max.y);
+    mesh.bounding_box.zpos = glm::vec2(min.z, max.z);
+
+    parallel_for(m_nb_triangles, 1 << 14, [&](size_t t){
+        size_t corners[3];
+        triangle(t, corners);
+        for (int i = 0; i < 3; ++i) mesh.indices[3 * t + i] = (mesh_index) corners[i];
+    });
+    return true;
+}
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// write off file : records are formatted by blocks, each block in parallel chunks
+bool MeshGenerator::write_OFF_file(const std::string & filename) const
+{
+    std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        std::cerr << "Failure to create " << filename << " file" << std::endl;
+        return false;
+    }
+    out << "OFF\n" << m_nb_vertices << " " << m_nb_triangles << " 0\n";
+
+    // a float takes at most 15 characters, an index 20, plus separators
+    const size_t nb_records = m_nb_vertices + m_nb_triangles;
+    const size_t block_records = (size_t) parallel_num_threads() << 16;
+    std::vector<std::string> chunk_text(parallel_num_threads());
+    for (size_t block = 0; block < nb_records && out.good(); block += block_records)
+    {
+        const size_t block_size = std::min(block_records, nb_records - block);
+        const unsigned int nb_chunks = parallel_nb_chunks(block_size, 1 << 14);
+        parallel_chunks(block_size, nb_chunks, [&](unsigned int c, size_t begin, size_t end){
+            std::string & text = chunk_text[c];
+            text.resize((end - begin) * 72);
+            char * p = &text[0], * text_end = p + text.size();
+            for (size_t r = block + begin; r < block + end; ++r)
+            {
+                if (r < m_nb_vertices)
+                {
+                    glm::vec3 position, normal;
+                    vertex(r, position, normal);
+                    p = format_number(p, text_end, position.x, ' ');
+                    p = format_number(p, text_end, position.y, ' ');
+                    p = format_number(p, text_end, position.z, '\n');
+                }
+                else
+                {
+                    size_t corners[3];
+                    triangle(r - m_nb_vertices, corners);
+                    *p++ = '3'; *p++ = ' ';
+                    p = format_number(p, text_end, corners[0], ' ');
+                    p = format_number(p, text_end, corners[1], ' ');
+                    p = format_number(p, text_end, corners[2], '\n');
+                }
+            }
+            text.resize(p - &text[0]);
+        });
+        for (unsigned int c = 0; c < nb_chunks; ++c) out.write(chunk_text[c].data(), chunk_text[c].size());
+    }
+    if (!out.good())
+    {
+        std::cerr << "Failure to write " << filename << " file" << std::endl;
+        return false;
+    }
+    return true;
+}
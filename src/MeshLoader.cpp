@@ -0,0 +1,240 @@
+#include "Mesh.hpp"
+#include "Parallel.hpp"
+#include "MappedFile.hpp"
+#include "TextParsing.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <cctype>
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// load off file : memory-mapped and parsed in parallel
+
+bool Mesh::load_OFF_file(const std::string & filename, std::vector< glm::vec3 > & vertices,
+                         std::vector< glm::vec3 > & normals, std::vector< mesh_index > & indices,
+                         glm::vec2 & xpos, glm::vec2 & ypos, glm::vec2 & zpos)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    MappedFile file(filename);
+    if (!file.valid())
+    {
+        std::cout << "Failure to open " << filename << " file" << std::endl;
+        return false;
+    }
+
+    // header : "OFF" then numbers of vertices, faces and edges
+    const char * p = skip_spaces(file.begin(), file.end());
+    if (file.end() - p < 3 || std::strncmp(p, "OFF", 3) != 0 || (p + 3 < file.end() && !std::isspace((unsigned char) p[3])))
+    {
+        std::cerr << "File " << filename << " isn't an OFF format file" << std::endl;
+        return false;
+    }
+    p += 3;
+
+    long long header[3] = {0, 0, 0};
+    for (long long & value : header)
+    {
+        p = skip_spaces(p, file.end());
+        p = parse_number(p, file.end(), value);
+        if (p == nullptr || value < 0)
+        {
+            std::cerr << "File " << filename << " has an invalid OFF header" << std::endl;
+            return false;
+        }
+    }
+    const size_t numberOfVertices = header[0], numberOfFaces = header[1];
+
+    // every vertex must be addressable with the compiled index type
+    if((unsigned long long) numberOfVertices > (unsigned long long) std::numeric_limits<mesh_index>::max() + 1)
+    {
+        std::cerr << "File " << filename << " has " << numberOfVertices << " vertices, more than a "
+                  << sizeof(mesh_index) * 8 << "-bit index can address" << std::endl;
+        return false;
+    }
+
+    // body starts on the line following the header
+    const char * body = next_line(p, file.end());
+    const size_t body_size = file.end() - body;
+
+    // split the body in chunks starting at line boundaries
+    const unsigned int nb_chunks = (unsigned int) std::max<size_t>(1, std::min<size_t>(parallel_num_threads(), body_size / (1 << 16)));
+    std::vector<const char *> chunk_begin(nb_chunks + 1, file.end());
+    chunk_begin[0] = body;
+    for (unsigned int c = 1; c < nb_chunks; ++c)
+    {
+        chunk_begin[c] = next_line(std::max(body + body_size * c / nb_chunks, chunk_begin[c - 1]), file.end());
+    }
+
+    // first pass : count records of each chunk to know the global index of its first record
+    std::vector<size_t> chunk_first_record(nb_chunks + 1, 0);
+    parallel_chunks(nb_chunks, nb_chunks, [&](unsigned int c, size_t, size_t){
+        size_t count = 0;
+        for (const char * line = chunk_begin[c]; line < chunk_begin[c + 1]; line = next_line(line, chunk_begin[c + 1]))
+        {
+            if (is_record(line, chunk_begin[c + 1])) ++count;
+        }
+        chunk_first_record[c + 1] = count;
+    });
+    for (unsigned int c = 0; c < nb_chunks; ++c) chunk_first_record[c + 1] += chunk_first_record[c];
+
+    if (chunk_first_record[nb_chunks] < numberOfVertices + numberOfFaces)
+    {
+        std::cerr << "File " << filename << " ends before its " << numberOfVertices << " vertices and "
+                  << numberOfFaces << " faces" << std::endl;
+        return false;
+    }
+
+    vertices.resize(numberOfVertices);
+    normals.resize(numberOfVertices);
+    indices.resize(3 * numberOfFaces);
+
+    // second pass : parse vertices and faces, and reduce the bounding box of each chunk
+    std::vector<glm::vec3> chunk_min(nb_chunks, glm::vec3(FLT_MAX)), chunk_max(nb_chunks, glm::vec3(-FLT_MAX));
+    std::vector<std::string> chunk_error(nb_chunks);
+    parallel_chunks(nb_chunks, nb_chunks, [&](unsigned int c, size_t, size_t){
+        const char * end = chunk_begin[c + 1];
+        size_t record = chunk_first_record[c];
+        glm::vec3 bmin(FLT_MAX), bmax(-FLT_MAX);
+
+        for (const char * line = chunk_begin[c]; line < end && record < numberOfVertices + numberOfFaces;
+             line = next_line(line, end))
+        {
+            if (!is_record(line, end)) continue;
+
+            if (record < numberOfVertices)
+            {
+                glm::vec3 & vertex = vertices[record];
+                const char * q = parse_number(line, end, vertex.x);
+                if (q) q = parse_number(q, end, vertex.y);
+                if (q) q = parse_number(q, end, vertex.z);
+                if (q == nullptr) { chunk_error[c] = "Invalid vertex " + std::to_string(record); return; }
+                bmin = glm::min(bmin, vertex);
+                bmax = glm::max(bmax, vertex);
+            }
+            else
+            {
+                size_t f = record - numberOfVertices;
+                int numberOfVerticesOnFace = 0;
+                const char * q = parse_number(line, end, numberOfVerticesOnFace);
+                if (q == nullptr || numberOfVerticesOnFace != 3) { chunk_error[c] = "Number of vertices on face must be 3"; return; }
+                for (int i = 0; i < 3 && q; ++i)
+                {
+                    unsigned long long v = 0;
+                    q = parse_number(q, end, v);
+                    if (q && v >= numberOfVertices) q = nullptr;
+                    if (q) indices[3 * f + i] = (mesh_index) v;
+                }
+                if (q == nullptr) { chunk_error[c] = "Invalid face " + std::to_string(f); return; }
+            }
+            ++record;
+        }
+        chunk_min[c] = bmin;
+        chunk_max[c] = bmax;
+    });
+
+    glm::vec3 bmin(FLT_MAX), bmax(-FLT_MAX);
+    for (unsigned int c = 0; c < nb_chunks; ++c)
+    {
+        if (!chunk_error[c].empty())
+        {
+            std::cerr << "File " << filename << " : " << chunk_error[c] << std::endl;
+            return false;
+        }
+        bmin = glm::min(bmin, chunk_min[c]);
+        bmax = glm::max(bmax, chunk_max[c]);
+    }
+    if (numberOfVertices > 0)
+    {
+        xpos = glm::vec2(bmin.x, bmax.x);
+        ypos = glm::vec2(bmin.y, bmax.y);
+        zpos = glm::vec2(bmin.z, bmax.z);
+    }
+
+    // average of the normals of the faces around each vertex : face normals are computed
+    // in parallel, then summed in face order so that results don't depend on the thread count
+    std::vector<glm::vec3> face_normals(numberOfFaces);
+    parallel_for(numberOfFaces, 1 << 14, [&](size_t f){
+        Triangle triangle(indices, (unsigned int) f);
+        glm::vec3 tmp1 = vertices[triangle[1]] - vertices[triangle[0]];
+        glm::vec3 tmp2 = vertices[triangle[2]] - vertices[triangle[0]];
+        face_normals[f] = glm::normalize(glm::cross(tmp1, tmp2));
+    });
+
+    std::vector<unsigned int> normalsCount(numberOfVertices, 0);
+    std::fill(normals.begin(), normals.end(), glm::vec3(0.0f));
+    for (size_t f = 0; f < numberOfFaces; ++f)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            normals[indices[3 * f + i]] += face_normals[f];
+            normalsCount[indices[3 * f + i]]++;
+        }
+    }
+    for (size_t v = 0; v < numberOfVertices; ++v)
+    {
+        normals[v] = normals[v] / (float) normalsCount[v];
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    double megabytes = file.size() / (1024.0 * 1024.0);
+    std::cout << "Parsed " << megabytes << " MB in " << seconds * 1000.0 << " ms ("
+              << (seconds > 0.0 ? megabytes / seconds : 0.0) << " MB/s, " << nb_chunks << " thread(s))" << std::endl;
+    return true;
+}
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// write off file : chunks of vertices and triangles are formatted in parallel
+
+bool Mesh::write_OFF_file(const std::string & filename) const
+{
+    const size_t nb_vertices = indexed_vertices.size(), nb_triangles = getNumberOfTriangles();
+    const size_t nb_records = nb_vertices + nb_triangles;
+
+    // a float takes at most 15 characters, a 32-bit index 10, plus separators
+    const unsigned int nb_chunks = parallel_nb_chunks(nb_records, 1 << 14);
+    std::vector<std::string> chunk_text(nb_chunks);
+    parallel_chunks(nb_records, nb_chunks, [&](unsigned int c, size_t begin, size_t end){
+        std::string & text = chunk_text[c];
+        text.resize((end - begin) * 48);
+        char * p = &text[0], * text_end = p + text.size();
+        for (size_t r = begin; r < end; ++r)
+        {
+            if (r < nb_vertices)
+            {
+                const glm::vec3 & v = indexed_vertices[r];
+                p = format_number(p, text_end, v.x, ' ');
+                p = format_number(p, text_end, v.y, ' ');
+                p = format_number(p, text_end, v.z, '\n');
+            }
+            else
+            {
+                Triangle triangle = this->triangle((unsigned int) (r - nb_vertices));
+                *p++ = '3'; *p++ = ' ';
+                p = format_number(p, text_end, triangle[0], ' ');
+                p = format_number(p, text_end, triangle[1], ' ');
+                p = format_number(p, text_end, triangle[2], '\n');
+            }
+        }
+        text.resize(p - &text[0]);
+    });
+
+    std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        std::cerr << "Failure to create " << filename << " file" << std::endl;
+        return false;
+    }
+    out << "OFF\n" << nb_vertices << " " << nb_triangles << " 0\n";
+    for (const std::string & text : chunk_text) out.write(text.data(), text.size());
+    if (!out.good())
+    {
+        std::cerr << "Failure to write " << filename << " file" << std::endl;
+        return false;
+    }
+    return true;
+}
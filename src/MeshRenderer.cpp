@@ -1,7 +1,8 @@
 #include "MeshRenderer.hpp"
 
 MeshRenderer::MeshRenderer(unsigned int shaderID, Mesh& mesh)
-    : VertexArrayID(0), vertexbuffer(0), uvbuffer(0), normalbuffer(0), valencefieldbuffer(0), elementbuffer(0)
+    : VertexArrayID(0), vertexbuffer(0), uvbuffer(0), normalbuffer(0), valencefieldbuffer(0), elementbuffer(0),
+      elementtype(GL_UNSIGNED_INT)
 {
     tridimodel = mesh;
     
@@ -33,8 +34,7 @@ MeshRenderer::MeshRenderer(unsigned int shaderID, Mesh& mesh)
 
     // Generate a buffer for the indices as well
     glGenBuffers(1, &elementbuffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementbuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, tridimodel.indices.size() * sizeof(unsigned short), &tridimodel.indices[0] , GL_STATIC_DRAW);
+    uploadIndices();
 
     // Get a handle for our "LightPosition" uniform
     glUseProgram(programID);
@@ -138,7 +138,7 @@ void MeshRenderer::draw(int camPlacement, float lightPlacement, bool show_valenc
     glDrawElements(
                 GL_TRIANGLES,      // mode
                 tridimodel.indices.size(),    // count
-                GL_UNSIGNED_SHORT,   // type
+                elementtype,       // type
                 nullptr           // element array buffer offset
                 );
 
@@ -157,8 +157,26 @@ void MeshRenderer::updateBuffers()
     glBufferData(GL_ARRAY_BUFFER, tridimodel.indexed_normals.size() * sizeof(glm::vec3), &tridimodel.indexed_normals[0], GL_STATIC_DRAW);
     glBindBuffer(GL_ARRAY_BUFFER, valencefieldbuffer);
     glBufferData(GL_ARRAY_BUFFER, tridimodel.valence_field.size() * sizeof(float), &tridimodel.valence_field[0], GL_STATIC_DRAW);
+    uploadIndices();
+}
+
+void MeshRenderer::uploadIndices()
+{
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementbuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, tridimodel.indices.size() * sizeof(unsigned short), &tridimodel.indices[0] , GL_STATIC_DRAW);
+
+    // a simplified mesh often fits in 16 bits: halve the index bandwidth in that case
+    if(sizeof(mesh_index) > sizeof(unsigned short) &&
+       tridimodel.indexed_vertices.size() <= (size_t) std::numeric_limits<unsigned short>::max() + 1)
+    {
+        std::vector<unsigned short> short_indices(tridimodel.indices.begin(), tridimodel.indices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, short_indices.size() * sizeof(unsigned short), short_indices.data(), GL_STATIC_DRAW);
+        elementtype = GL_UNSIGNED_SHORT;
+    }
+    else
+    {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, tridimodel.indices.size() * sizeof(mesh_index), tridimodel.indices.data(), GL_STATIC_DRAW);
+        elementtype = (sizeof(mesh_index) == sizeof(unsigned short)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    }
 }
 
 void MeshRenderer::cleanUp()
@@ -0,0 +1,254 @@
+#include "MeshStream.hpp"
+#include "Parallel.hpp"
+#include "TextParsing.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// constructor : header of the cache, or of the OFF file
+
+MeshStream::MeshStream(const std::string & filename, bool use_cache, size_t block_bytes)
+    : m_filename(filename), m_block_bytes(std::max<size_t>(block_bytes, 1 << 16))
+{
+    size_t nb_indices = 0;
+    if (use_cache && open_cache(filename, m_cache, m_nb_vertices, nb_indices, m_vertices_offset, m_indices_offset, m_index_size))
+    {
+        m_from_cache = true;
+        m_nb_triangles = nb_indices / 3;
+        return;
+    }
+
+    // "OFF" then numbers of vertices, faces and edges, with the comments before them, in the first block
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    if (!in.is_open())
+    {
+        m_error = "Failure to open " + filename + " file";
+        return;
+    }
+    std::vector<char> head(std::min<size_t>(m_block_bytes, 1 << 16));
+    in.read(head.data(), head.size());
+    const char * begin = head.data(), * end = begin + in.gcount();
+
+    const char * p = skip_spaces(begin, end);
+    if (end - p < 3 || std::strncmp(p, "OFF", 3) != 0 || (p + 3 < end && !std::isspace((unsigned char) p[3])))
+    {
+        m_error = "File " + filename + " isn't an OFF format file";
+        return;
+    }
+    p += 3;
+
+    long long header[3] = {0, 0, 0};
+    for (long long & value : header)
+    {
+        p = skip_spaces(p, end);
+        p = parse_number(p, end, value);
+        if (p == nullptr || value < 0 || value > (long long) UINT32_MAX)
+        {
+            m_error = "File " + filename + " has an invalid OFF header";
+            return;
+        }
+    }
+    m_nb_vertices = (size_t) header[0];
+    m_nb_triangles = (size_t) header[1];
+    m_body_offset = next_line(p, end) - begin;
+}
+
+bool MeshStream::read(const VertexBlock & vertices, const TriangleBlock & triangles)
+{
+    if (!valid()) return false;
+    return m_from_cache ? read_cache(vertices, triangles) : read_OFF(vertices, triangles);
+}
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// OFF text : blocks of complete lines, the partial line at the end of a block is moved to the next one.
+// Each block is parsed in parallel like in Mesh::load_OFF_file
+
+bool MeshStream::read_OFF(const VertexBlock & on_vertices, const TriangleBlock & on_triangles)
+{
+    std::ifstream in(m_filename.c_str(), std::ios::binary);
+    if (!in.is_open() || !in.seekg((std::streamoff) m_body_offset))
+    {
+        m_error = "Failure to open " + m_filename + " file";
+        return false;
+    }
+
+    const size_t nb_records = m_nb_vertices + m_nb_triangles;
+    std::vector<char> buffer(m_block_bytes);
+    std::vector<glm::vec3> vertices;
+    std::vector<uint32_t> indices;
+    size_t record = 0, carry = 0;
+
+    while (record < nb_records)
+    {
+        in.read(buffer.data() + carry, (std::streamsize) (buffer.size() - carry));
+        const size_t size = carry + (size_t) in.gcount();
+        const bool at_end = !in;
+        const char * begin = buffer.data(), * end = begin + size;
+        if (!at_end)
+        {
+            // the block ends after its last new line
+            const char * last = end;
+            while (last > begin && last[-1] != '\n') --last;
+            if (last == begin)
+            {
+                m_error = "File " + m_filename + " has a line longer than the blocks of " + std::to_string(buffer.size()) + " bytes";
+                return false;
+            }
+            end = last;
+        }
+
+        // split the block in chunks starting at line boundaries, count the records of each chunk
+        const size_t block_size = end - begin;
+        const unsigned int nb_chunks = (unsigned int) std::max<size_t>(1, std::min<size_t>(parallel_num_threads(), block_size / (1 << 16)));
+        std::vector<const char *> chunk_begin(nb_chunks + 1, end);
+        chunk_begin[0] = begin;
+        for (unsigned int c = 1; c < nb_chunks; ++c)
+        {
+            chunk_begin[c] = next_line(std::max(begin + block_size * c / nb_chunks, chunk_begin[c - 1]), end);
+        }
+        std::vector<size_t> chunk_first_record(nb_chunks + 1, 0);
+        parallel_chunks(nb_chunks, nb_chunks, [&](unsigned int c, size_t, size_t){
+            size_t count = 0;
+            for (const char * line = chunk_begin[c]; line < chunk_begin[c + 1]; line = next_line(line, chunk_begin[c + 1]))
+            {
+                if (is_record(line, chunk_begin[c + 1])) ++count;
+            }
+            chunk_first_record[c + 1] = count;
+        });
+        chunk_first_record[0] = record;
+        for (unsigned int c = 0; c < nb_chunks; ++c) chunk_first_record[c + 1] += chunk_first_record[c];
+        const size_t block_end = std::min(chunk_first_record[nb_chunks], nb_records);
+
+        // records [record, block_end) : vertices then triangles
+        const size_t first_vertex = std::min(record, m_nb_vertices), end_vertex = std::min(block_end, m_nb_vertices);
+        const size_t first_triangle = std::max(record, m_nb_vertices) - m_nb_vertices;
+        const size_t end_triangle = std::max(block_end, m_nb_vertices) - m_nb_vertices;
+        vertices.resize(end_vertex - first_vertex);
+        indices.resize(3 * (end_triangle - first_triangle));
+        m_peak_bytes = std::max(m_peak_bytes, buffer.capacity() + vertices.capacity() * sizeof(glm::vec3) +
+                                              indices.capacity() * sizeof(uint32_t));
+
+        std::vector<std::string> chunk_error(nb_chunks);
+        parallel_chunks(nb_chunks, nb_chunks, [&](unsigned int c, size_t, size_t){
+            const char * chunk_end = chunk_begin[c + 1];
+            size_t r = chunk_first_record[c];
+            for (const char * line = chunk_begin[c]; line < chunk_end && r < block_end; line = next_line(line, chunk_end))
+            {
+                if (!is_record(line, chunk_end)) continue;
+                if (r < m_nb_vertices)
+                {
+                    glm::vec3 & vertex = vertices[r - first_vertex];
+                    const char * q = parse_number(line, chunk_end, vertex.x);
+                    if (q) q = parse_number(q, chunk_end, vertex.y);
+                    if (q) q = parse_number(q, chunk_end, vertex.z);
+                    if (q == nullptr) { chunk_error[c] = "Invalid vertex " + std::to_string(r); return; }
+                }
+                else
+                {
+                    const size_t t = r - m_nb_vertices - first_triangle;
+                    int numberOfVerticesOnFace = 0;
+                    const char * q = parse_number(line, chunk_end, numberOfVerticesOnFace);
+                    if (q == nullptr || numberOfVerticesOnFace != 3) { chunk_error[c] = "Number of vertices on face must be 3"; return; }
+                    for (int i = 0; i < 3 && q; ++i)
+                    {
+                        unsigned long long v = 0;
+                        q = parse_number(q, chunk_end, v);
+                        if (q && v >= m_nb_vertices) q = nullptr;
+                        if (q) indices[3 * t + i] = (uint32_t) v;
+                    }
+                    if (q == nullptr) { chunk_error[c] = "Invalid face " + std::to_string(r - m_nb_vertices); return; }
+                }
+                ++r;
+            }
+        });
+        for (const std::string & error : chunk_error)
+        {
+            if (!error.empty())
+            {
+                m_error = "File " + m_filename + " : " + error;
+                return false;
+            }
+        }
+
+        if (!vertices.empty() && !on_vertices(first_vertex, vertices)) return false;
+        if (!indices.empty() && !on_triangles(first_triangle, indices)) return false;
+        record = block_end;
+
+        if (at_end) break;
+        carry = buffer.data() + size - end;
+        std::memmove(buffer.data(), end, carry);
+    }
+
+    if (record < nb_records)
+    {
+        m_error = "File " + m_filename + " ends before its " + std::to_string(m_nb_vertices) + " vertices and " +
+                  std::to_string(m_nb_triangles) + " faces";
+        return false;
+    }
+    return true;
+}
+
+// ******************************************************************************************************
+// ******************************************************************************************************
+// ******************************************************************************************************
+// binary cache : sections are copied block by block, indices of either size are widened to 32 bits
+
+bool MeshStream::read_cache(const VertexBlock & on_vertices, const TriangleBlock & on_triangles)
+{
+    std::ifstream in(m_cache.c_str(), std::ios::binary);
+    if (!in.is_open() || !in.seekg((std::streamoff) m_vertices_offset))
+    {
+        m_error = "Failure to open " + m_cache + " file";
+        return false;
+    }
+
+    std::vector<glm::vec3> vertices;
+    const size_t block_vertices = m_block_bytes / sizeof(glm::vec3);
+    for (size_t first = 0; first < m_nb_vertices; first += block_vertices)
+    {
+        vertices.resize(std::min(block_vertices, m_nb_vertices - first));
+        if (!in.read((char *) vertices.data(), (std::streamsize) (vertices.size() * sizeof(glm::vec3))))
+        {
+            m_error = "Failure to read " + m_cache + " file";
+            return false;
+        }
+        m_peak_bytes = std::max(m_peak_bytes, vertices.capacity() * sizeof(glm::vec3));
+        if (!on_vertices(first, vertices)) return false;
+    }
+    vertices = std::vector<glm::vec3>();
+
+    if (!in.seekg((std::streamoff) m_indices_offset))
+    {
+        m_error = "Failure to read " + m_cache + " file";
+        return false;
+    }
+    std::vector<uint32_t> indices;
+    std::vector<uint16_t> short_indices;
+    const size_t block_triangles = m_block_bytes / (3 * sizeof(uint32_t));
+    for (size_t first = 0; first < m_nb_triangles; first += block_triangles)
+    {
+        indices.resize(3 * std::min(block_triangles, m_nb_triangles - first));
+        bool read;
+        if (m_index_size == 4) read = (bool) in.read((char *) indices.data(), (std::streamsize) (indices.size() * 4));
+        else
+        {
+            short_indices.resize(indices.size());
+            read = (bool) in.read((char *) short_indices.data(), (std::streamsize) (short_indices.size() * 2));
+            std::copy(short_indices.begin(), short_indices.end(), indices.begin());
+        }
+        if (!read || std::any_of(indices.begin(), indices.end(), [&](uint32_t v){ return v >= m_nb_vertices; }))
+        {
+            m_error = "Failure to read " + m_cache + " file";
+            return false;
+        }
+        m_peak_bytes = std::max(m_peak_bytes, indices.capacity() * sizeof(uint32_t) + short_indices.capacity() * sizeof(uint16_t));
+        if (!on_triangles(first, indices)) return false;
+    }
+    return true;
+}
@@ -25,10 +25,13 @@
 // settings
 #define GRID        0
 #define OCTREE      1
+#define EDGE        2
 #define MIN_GRID    2
-#define MAX_GRID    100
+#define MAX_GRID    1000
 #define MIN_OCTREE  5
 #define MAX_OCTREE  150
+#define MIN_EDGE    1
+#define MAX_EDGE    100
 
 unsigned int SCR_WIDTH = 1920;
 unsigned int SCR_HEIGHT = 1080;
@@ -36,12 +39,15 @@ unsigned int SCR_HEIGHT = 1080;
 bool firstMouse = true;
 double cursorXpos, cursorYpos;
 float generationTime = 0.0f;
-bool regenerate(false), backToOriginal(false);
+bool regenerate(false), backToOriginal(false), refine(false);
 unsigned short currentMode = GRID;
-int maxNumberPerLeaf(MIN_OCTREE), girdResolution(MAX_GRID);
-bool showValence(false), wireFrame(false), lighting(true);
+int maxNumberPerLeaf(MIN_OCTREE), girdResolution(MAX_GRID), edgeTargetPercent(50);
+bool showValence(false), wireFrame(false), lighting(true), quadricPlacement(false), parallelCollapses(false), progressiveCollapses(false);
 int camPlacement(0); float lightPlacement(0.5);
 unsigned int meshVertices(0);
+// collapses of the last edge simplification, when progressive : the slider of the number of vertices refines it
+ProgressiveMesh progressiveMesh;
+int progressiveVertices(0);
 std::string loadedObjName, lastLoadedObjName;
 
 // math
@@ -109,6 +115,7 @@ int main()
     // create mesh
     Mesh tridimodel = Mesh((currentPath+"/assets/models/teddy.off").c_str());
     Mesh originalmodel = tridimodel;
+    originalmodel.adjacency();  // built once, copied with the original mesh at each regenerate
 
     // process
     tridimodel.compute_smooth_vertex_normals(0);
@@ -148,21 +155,35 @@ int main()
             tridimodel = Mesh((currentPath+"/assets/models/"+loadedObjName+".off").c_str());
             maxNumberPerLeaf = MIN_OCTREE;
             girdResolution = MAX_GRID;
+            edgeTargetPercent = 50;
             notsimplify = true;
             originalmodel = tridimodel;
+            originalmodel.adjacency();
             regenerate = true;
         }
         if(regenerate){
             regenerate = false;
             tridimodel = originalmodel;
+            progressiveMesh = ProgressiveMesh();
             if (!notsimplify) {
                 switch (currentMode) {
                     case GRID :
-                        tridimodel.simplify(girdResolution);
+                        tridimodel.simplify(girdResolution, quadricPlacement ? GridPlacement::QUADRIC : GridPlacement::AVERAGE);
                         break;
                     case OCTREE :
                         tridimodel.adaptiveSimplify(maxNumberPerLeaf);
                         break;
+                    case EDGE : {
+                        unsigned int target = (unsigned int) ((double) originalmodel.getNumberOfTriangles() * edgeTargetPercent / 100.0);
+                        if (progressiveCollapses) {
+                            progressiveMesh = originalmodel.buildProgressiveMesh(target);
+                            progressiveMesh.extract(tridimodel);
+                            progressiveVertices = (int) progressiveMesh.getNumberOfVertices();
+                        }
+                        else if (parallelCollapses) tridimodel.decimateParallel(target);
+                        else tridimodel.decimate(target);
+                        break;
+                    }
                     default: break;
                 }
             }
@@ -172,9 +193,19 @@ int main()
             mrenderer.updateBuffers();
             notsimplify = false;
         }
+        if(refine){
+            // only the splits between the two numbers of vertices are applied or undone
+            refine = false;
+            progressiveMesh.setNumberOfVertices((unsigned int) progressiveVertices);
+            progressiveMesh.extract(tridimodel);
+            tridimodel.compute_vertex_valences();
+            mrenderer.tridimodel = tridimodel;
+            mrenderer.updateBuffers();
+        }
         if(backToOriginal){
             backToOriginal = false;
             tridimodel = originalmodel;
+            progressiveMesh = ProgressiveMesh();
             tridimodel.compute_smooth_vertex_normals(0);
             tridimodel.compute_vertex_valences();
             mrenderer.tridimodel = tridimodel;
@@ -375,7 +406,13 @@ void renderGui(){
         ImGui::SetWindowSize(ImVec2(400, (float)SCR_HEIGHT));
         ImGui::Dummy(ImVec2(0.0f, 20.0f));
 
-        ImGui::Text(("Number of vertices : "+std::to_string(meshVertices)).c_str());
+        if (!progressiveMesh.splits.empty()) {
+            ImGui::Text("Number of vertices");
+            ImGui::PushItemWidth(ImGui::GetWindowWidth() * 0.96f);
+            const int nb_base = (int) progressiveMesh.nb_base_vertices;
+            if (ImGui::SliderInt("##vertices", &progressiveVertices, nb_base, nb_base + (int) progressiveMesh.splits.size())) refine = true;
+        }
+        else ImGui::Text(("Number of vertices : "+std::to_string(meshVertices)).c_str());
         ImGui::Dummy(ImVec2(0.0f, 20.0f));
         ImGui::Separator();
         ImGui::Dummy(ImVec2(0.0f, 10.0f));
@@ -385,6 +422,8 @@ void renderGui(){
         if(ImGui::RadioButton("Grid", currentMode == GRID) ) currentMode = GRID;
         ImGui::SameLine();
         if(ImGui::RadioButton("Octree", currentMode == OCTREE) ) currentMode = OCTREE;
+        ImGui::SameLine();
+        if(ImGui::RadioButton("Edge collapse", currentMode == EDGE) ) currentMode = EDGE;
 
         ImGui::Dummy(ImVec2(0.0f, 20.0f));
 
@@ -392,6 +431,8 @@ void renderGui(){
             ImGui::Text("Grid resolution");
             ImGui::PushItemWidth(ImGui::GetWindowWidth() * 0.96f);
             ImGui::SliderInt("", &girdResolution, MIN_GRID, MAX_GRID);
+            ImGui::Dummy(ImVec2(0.0f, 3.0f));
+            ImGui::Checkbox("Quadric placement", &quadricPlacement);
         }
 
         if(currentMode == OCTREE) {
@@ -399,6 +440,16 @@ void renderGui(){
             ImGui::PushItemWidth(ImGui::GetWindowWidth() * 0.96f);
             ImGui::SliderInt("", &maxNumberPerLeaf, MIN_OCTREE, MAX_OCTREE);
         }
+
+        if(currentMode == EDGE) {
+            ImGui::Text("Triangles kept (%%)");
+            ImGui::PushItemWidth(ImGui::GetWindowWidth() * 0.96f);
+            ImGui::SliderInt("", &edgeTargetPercent, MIN_EDGE, MAX_EDGE);
+            ImGui::Dummy(ImVec2(0.0f, 3.0f));
+            ImGui::Checkbox("Parallel rounds", &parallelCollapses);
+            ImGui::Dummy(ImVec2(0.0f, 3.0f));
+            ImGui::Checkbox("Progressive", &progressiveCollapses);
+        }
         ImGui::Dummy(ImVec2(0.0f, 20.0f));
 
         {
@@ -0,0 +1,554 @@
+// Behaviour tests of the mesh code, run by ctest : each test is a small mesh and a few checks,
+// the program returns 0 when they all hold and prints the failed ones otherwise.
+//
+// usage : mesh_tests <test> [arguments]
+//
+//   normals                 no NaN normal around zero-area triangles, with the three weightings
+//   decimate_closed         decimate, decimateParallel and buildProgressiveMesh on a tetrahedron and an icosphere
+//   decimate_open           the same on an open strip
+//   progressive             buildProgressiveMesh then setNumberOfVertices down, up and back to the same state
+//   lod                     buildLODChain levels against separate decimations, and the ratios out of ]0, 1[
+//   halfedge                twins and outgoing half-edges of HalfEdgeMesh after collapses and after compact
+//   streaming               simplifyStreaming of a flat mesh (no quadric minimum) gives the cell averages of simplify
+//   cache                   the same mesh loaded from its .mcache and from its OFF file, and a corrupted
+//                           .mcache replaced when loaded and ignored when streamed
+//   determinism <output> [reference]
+//                           digests of the results of the parallel code written to output, compared to the
+//                           ones of reference when given (computed with another MESH_NUM_THREADS) :
+//                           parseOFF, simplify, decimateParallel, HalfEdgeMesh
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "HalfEdgeMesh.hpp"
+#include "Mesh.hpp"
+#include "MeshGenerator.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+unsigned int nb_failures = 0;
+
+void check(bool condition, const std::string & what)
+{
+    if (condition) return;
+    std::fprintf(stderr, "FAILED : %s\n", what.c_str());
+    ++nb_failures;
+}
+
+// ******************************************************************************************************
+// meshes
+
+Mesh generated(MeshGenerator::Shape shape, size_t nb_triangles)
+{
+    Mesh mesh;
+    MeshGenerator(shape, nb_triangles).generate(mesh);
+    return mesh;
+}
+
+Mesh tetrahedron()
+{
+    Mesh mesh;
+    mesh.indexed_vertices = {{0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}};
+    mesh.indices = {0, 2, 1, 0, 1, 3, 0, 3, 2, 1, 2, 3};
+    return mesh;
+}
+
+// nb_columns x nb_rows quads bent on a quarter of cylinder, open on its four sides
+Mesh strip(unsigned int nb_columns, unsigned int nb_rows)
+{
+    Mesh mesh;
+    for (unsigned int j = 0; j <= nb_rows; ++j) {
+        for (unsigned int i = 0; i <= nb_columns; ++i) {
+            const float angle = 1.5707963f * (float) i / (float) nb_columns;
+            mesh.indexed_vertices.emplace_back(std::cos(angle), std::sin(angle), 0.1f * (float) j);
+        }
+    }
+    for (unsigned int j = 0; j < nb_rows; ++j) {
+        for (unsigned int i = 0; i < nb_columns; ++i) {
+            const mesh_index a = j * (nb_columns + 1) + i, b = a + 1, c = a + nb_columns + 1, d = c + 1;
+            mesh.indices.insert(mesh.indices.end(), {a, b, d, a, d, c});
+        }
+    }
+    return mesh;
+}
+
+// torus of nb_rings x nb_sides quads cut in two triangles, written in an OFF file
+bool write_torus(const std::string & filename, unsigned int nb_rings, unsigned int nb_sides)
+{
+    FILE * file = std::fopen(filename.c_str(), "w");
+    if (!file) return false;
+    std::fprintf(file, "OFF\n%u %u 0\n", nb_rings * nb_sides, 2 * nb_rings * nb_sides);
+    for (unsigned int i = 0; i < nb_rings; ++i) {
+        const double u = 6.283185307179586 * i / nb_rings;
+        for (unsigned int j = 0; j < nb_sides; ++j) {
+            const double v = 6.283185307179586 * j / nb_sides, radius = 1.0 + 0.3 * std::cos(v);
+            std::fprintf(file, "%.9g %.9g %.9g\n", radius * std::cos(u), radius * std::sin(u), 0.3 * std::sin(v));
+        }
+    }
+    for (unsigned int i = 0; i < nb_rings; ++i) {
+        for (unsigned int j = 0; j < nb_sides; ++j) {
+            const unsigned int a = i * nb_sides + j, b = i * nb_sides + (j + 1) % nb_sides;
+            const unsigned int c = (i + 1) % nb_rings * nb_sides + j, d = (i + 1) % nb_rings * nb_sides + (j + 1) % nb_sides;
+            std::fprintf(file, "3 %u %u %u\n3 %u %u %u\n", a, c, d, a, d, b);
+        }
+    }
+    return std::fclose(file) == 0;
+}
+
+// nb x nb quads in the plane z = 0, cut in two triangles, with vertices moved inside their quad
+bool write_plane(const std::string & filename, unsigned int nb)
+{
+    FILE * file = std::fopen(filename.c_str(), "w");
+    if (!file) return false;
+    std::fprintf(file, "OFF\n%u %u 0\n", (nb + 1) * (nb + 1), 2 * nb * nb);
+    for (unsigned int j = 0; j <= nb; ++j) {
+        for (unsigned int i = 0; i <= nb; ++i) {
+            std::fprintf(file, "%.9g %.9g 0\n", i + 0.3 * std::sin(7.0 * i + 3.0 * j), j + 0.3 * std::cos(5.0 * i + 11.0 * j));
+        }
+    }
+    for (unsigned int j = 0; j < nb; ++j) {
+        for (unsigned int i = 0; i < nb; ++i) {
+            const unsigned int a = j * (nb + 1) + i, b = a + 1, c = a + nb + 1, d = c + 1;
+            std::fprintf(file, "3 %u %u %u\n3 %u %u %u\n", a, b, d, a, d, c);
+        }
+    }
+    return std::fclose(file) == 0;
+}
+
+// ******************************************************************************************************
+// checks
+
+// no degenerate or duplicate triangle, each edge in one or two triangles of opposite orientations
+// (exactly two when closed) and each vertex in a single fan of triangles
+void check_manifold(const Mesh & mesh, bool closed, const std::string & name)
+{
+    const unsigned int nb_triangles = mesh.getNumberOfTriangles();
+    std::vector<std::array<mesh_index, 3>> faces;
+    std::map<std::pair<mesh_index, mesh_index>, unsigned int> directed;
+    std::vector<std::vector<std::pair<mesh_index, mesh_index>>> fans(mesh.indexed_vertices.size());
+    bool degenerate = false;
+    for (unsigned int t = 0; t < nb_triangles; ++t) {
+        std::array<mesh_index, 3> face = {mesh.indices[3 * t], mesh.indices[3 * t + 1], mesh.indices[3 * t + 2]};
+        degenerate = degenerate || face[0] == face[1] || face[1] == face[2] || face[2] == face[0];
+        for (short i = 0; i < 3; ++i) {
+            directed[{face[i], face[(i + 1) % 3]}]++;
+            fans[face[i]].emplace_back(face[(i + 1) % 3], face[(i + 2) % 3]);
+        }
+        std::sort(face.begin(), face.end());
+        faces.push_back(face);
+    }
+    check(!degenerate, name + " has no degenerate triangle");
+    std::sort(faces.begin(), faces.end());
+    check(std::adjacent_find(faces.begin(), faces.end()) == faces.end(), name + " has no duplicate triangle");
+
+    bool oriented = true, borders = false;
+    for (const auto & edge : directed) {
+        oriented = oriented && edge.second == 1;
+        borders = borders || directed.count({edge.first.second, edge.first.first}) == 0;
+    }
+    check(oriented, name + " has edges in at most two triangles of opposite orientations");
+    if (closed) check(!borders, name + " stays closed");
+
+    // a single fan : the triangles around v, as edges between its neighbours, join all its neighbours
+    bool single = true;
+    for (const auto & fan : fans) {
+        if (fan.empty()) continue;
+        std::vector<mesh_index> neighbours;
+        for (const auto & edge : fan) neighbours.insert(neighbours.end(), {edge.first, edge.second});
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        std::vector<size_t> parent(neighbours.size());
+        std::iota(parent.begin(), parent.end(), 0);
+        auto root = [&](size_t i){ while (parent[i] != i) i = parent[i] = parent[parent[i]]; return i; };
+        auto local = [&](mesh_index v){ return (size_t) (std::lower_bound(neighbours.begin(), neighbours.end(), v) - neighbours.begin()); };
+        size_t nb_components = neighbours.size();
+        for (const auto & edge : fan) {
+            const size_t a = root(local(edge.first)), b = root(local(edge.second));
+            if (a != b) {
+                parent[a] = b;
+                --nb_components;
+            }
+        }
+        single = single && nb_components == 1;
+    }
+    check(single, name + " has a single fan of triangles around each vertex");
+}
+
+// twins are mutual and join the same two vertices in opposite directions, the outgoing half-edge
+// of a vertex leaves it and is on a border when the vertex is
+void check_halfedges(const HalfEdgeMesh & halfedges, const std::string & name)
+{
+    bool twins = true, outgoing = true;
+    std::vector<unsigned char> used(halfedges.nb_vertices(), 0), border(halfedges.nb_vertices(), 0);
+    for (unsigned int h = 0; h < halfedges.nb_halfedges(); ++h) {
+        if (halfedges.is_removed(HalfEdgeMesh::face(h))) continue;
+        used[halfedges.origin(h)] = 1;
+        if (halfedges.is_border(h)) {
+            border[halfedges.origin(h)] = 1;
+            continue;
+        }
+        const unsigned int twin = halfedges.twin(h);
+        twins = twins && !halfedges.is_removed(HalfEdgeMesh::face(twin)) && halfedges.twin(twin) == h &&
+                halfedges.origin(twin) == halfedges.target(h) && halfedges.target(twin) == halfedges.origin(h);
+    }
+    for (unsigned int v = 0; v < halfedges.nb_vertices(); ++v) {
+        const unsigned int h = halfedges.outgoing(v);
+        if (!used[v]) {
+            outgoing = outgoing && h == HalfEdgeMesh::NONE;
+            continue;
+        }
+        outgoing = outgoing && h != HalfEdgeMesh::NONE && !halfedges.is_removed(HalfEdgeMesh::face(h)) &&
+                   halfedges.origin(h) == v && halfedges.is_single_fan(v) && halfedges.is_border_vertex(v) == (border[v] != 0);
+    }
+    check(twins, name + " has mutual twins");
+    check(outgoing, name + " has an outgoing half-edge in the fan of each vertex");
+}
+
+// FNV-1a of the bytes of values
+template <typename T>
+uint64_t digest(const std::vector<T> & values, uint64_t hash = 14695981039346656037ull)
+{
+    const unsigned char * bytes = reinterpret_cast<const unsigned char *>(values.data());
+    for (size_t i = 0; i < values.size() * sizeof(T); ++i) hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+uint64_t digest(const Mesh & mesh)
+{
+    return digest(mesh.indices, digest(mesh.indexed_normals, digest(mesh.indexed_vertices)));
+}
+
+// ******************************************************************************************************
+// tests
+
+bool normals()
+{
+    // a unit triangle in the plane z = 0, and a zero-area triangle sharing its edge 1 2
+    // and a vertex of its own on that edge
+    Mesh mesh;
+    mesh.indexed_vertices = {{0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.5f, 0.5f, 0.0f}};
+    mesh.indices = {0, 1, 2, 2, 1, 3};
+    for (int weight = 0; weight < 3; ++weight) {
+        const std::string name = "weighting " + std::to_string(weight);
+        mesh.compute_smooth_vertex_normals(weight);
+        check(mesh.indexed_normals.size() == 4, name + " gives a normal per vertex");
+        for (unsigned int v = 0; v < 3; ++v) {
+            check(mesh.indexed_normals[v] == glm::vec3(0.0f, 0.0f, 1.0f), name + " gives the normal of the plane to vertex " + std::to_string(v));
+        }
+        check(mesh.indexed_normals[3] == glm::vec3(0.0f), name + " gives no normal to a vertex of zero-area triangles only");
+    }
+    return nb_failures == 0;
+}
+
+void test_decimate(Mesh mesh, bool closed, const std::string & name)
+{
+    const unsigned int nb_triangles = mesh.getNumberOfTriangles();
+    for (unsigned int target : {nb_triangles / 4, 0u}) {
+        const std::string step = name + " decimated to " + std::to_string(target);
+        Mesh decimated = mesh;
+        decimated.decimate(target);
+        check(decimated.getNumberOfTriangles() > 0, step + " keeps triangles");
+        check_manifold(decimated, closed, step);
+
+        Mesh parallel = mesh;
+        parallel.decimateParallel(target);
+        check(parallel.getNumberOfTriangles() > 0, step + " in parallel keeps triangles");
+        check_manifold(parallel, closed, step + " in parallel");
+
+        Mesh base;
+        mesh.buildProgressiveMesh(target).extract(base);
+        check_manifold(base, closed, step + " as a progressive base");
+    }
+}
+
+bool decimate_closed()
+{
+    test_decimate(tetrahedron(), true, "tetrahedron");
+    Mesh single = tetrahedron();
+    single.decimate(0);
+    check(single.getNumberOfTriangles() == 4, "tetrahedron isn't collapsed");
+    test_decimate(generated(MeshGenerator::ICOSPHERE, 2000), true, "icosphere");
+    return nb_failures == 0;
+}
+
+bool decimate_open()
+{
+    test_decimate(strip(40, 4), false, "strip");
+    return nb_failures == 0;
+}
+
+// triangles as their corner positions, rotated to start at the smallest corner and sorted
+std::vector<std::array<float, 9>> triangle_positions(const std::vector<glm::vec3> & vertices, const std::vector<mesh_index> & indices,
+                                                     size_t nb_triangles)
+{
+    std::vector<std::array<float, 9>> triangles;
+    for (size_t t = 0; t < nb_triangles; ++t) {
+        std::array<std::array<float, 3>, 3> corners;
+        for (short i = 0; i < 3; ++i) {
+            const glm::vec3 & p = vertices[indices[3 * t + i]];
+            corners[i] = {p.x, p.y, p.z};
+        }
+        std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end()), corners.end());
+        std::array<float, 9> triangle;
+        for (short i = 0; i < 9; ++i) triangle[i] = corners[i / 3][i % 3];
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+bool progressive()
+{
+    Mesh mesh = generated(MeshGenerator::ICOSPHERE, 2000);
+    ProgressiveMesh progressive = mesh.buildProgressiveMesh(100);
+    check(progressive.getNumberOfTriangles() <= 100, "base has at most 100 triangles");
+    const unsigned int nb_base_vertices = progressive.getNumberOfVertices();
+    const std::vector<glm::vec3> base_vertices(progressive.vertices.begin(), progressive.vertices.begin() + nb_base_vertices);
+    const std::vector<mesh_index> base_indices(progressive.indices.begin(), progressive.indices.begin() + 3 * progressive.getNumberOfTriangles());
+
+    // all the splits give the mesh back
+    progressive.setNumberOfVertices(mesh.getNumberOfVertices());
+    check(progressive.getNumberOfVertices() == mesh.getNumberOfVertices(), "all the splits give all the vertices");
+    check(triangle_positions(progressive.vertices, progressive.indices, progressive.getNumberOfTriangles()) ==
+          triangle_positions(mesh.indexed_vertices, mesh.indices, mesh.getNumberOfTriangles()), "all the splits give the triangles of the mesh");
+
+    // a state doesn't depend on the way it is reached
+    const unsigned int middle = (nb_base_vertices + mesh.getNumberOfVertices()) / 2;
+    progressive.setNumberOfVertices(middle);
+    Mesh from_above;
+    progressive.extract(from_above);
+    check_manifold(from_above, true, "progressive mesh in the middle");
+    progressive.setNumberOfVertices(0);
+    check(progressive.getNumberOfVertices() == nb_base_vertices, "undoing all the splits gives the base vertices");
+    check(std::equal(base_vertices.begin(), base_vertices.end(), progressive.vertices.begin()) &&
+          std::equal(base_indices.begin(), base_indices.end(), progressive.indices.begin()) &&
+          progressive.getNumberOfTriangles() * 3 == base_indices.size(), "undoing all the splits gives the base back");
+    progressive.setNumberOfVertices(middle);
+    Mesh from_below;
+    progressive.extract(from_below);
+    check(from_above.indexed_vertices == from_below.indexed_vertices && from_above.indices == from_below.indices,
+          "the middle state is the same from the base and from the mesh");
+    return nb_failures == 0;
+}
+
+bool lod()
+{
+    Mesh mesh = generated(MeshGenerator::ICOSPHERE, 2000);
+    const std::vector<mesh_index> indices = mesh.indices;
+    const LODChain chain = mesh.buildLODChain(5, 0.5f);
+    check(mesh.indices == indices, "the mesh isn't changed by its levels");
+    check(chain.getNumberOfLevels() == 5, "the chain has the levels asked");
+    double target = mesh.getNumberOfTriangles();
+    for (unsigned int level = 0; level < chain.getNumberOfLevels(); ++level) {
+        const std::string name = "level " + std::to_string(level);
+        Mesh extracted;
+        chain.extract(level, extracted);
+        check_manifold(extracted, true, name);
+        Mesh decimated = mesh;
+        if (level > 0) decimated.decimate((unsigned int) (target *= 0.5));
+        check(extracted.getNumberOfTriangles() == decimated.getNumberOfTriangles(), name + " has the triangles of a separate decimation");
+    }
+
+    // out of range, NaN included
+    for (float ratio : {0.0f, 1.0f, -0.5f, 2.0f, std::nanf("")}) {
+        check(mesh.buildLODChain(3, ratio).getNumberOfLevels() == 0, "ratio " + std::to_string(ratio) + " gives no level");
+    }
+    return nb_failures == 0;
+}
+
+// collapses of every allowed edge, at its midpoint, pass after pass
+void collapse_all(HalfEdgeMesh & halfedges, const std::string & name)
+{
+    HalfEdgeMesh::Scratch scratch;
+    unsigned int nb_collapses = 0;
+    for (short pass = 0; pass < 3; ++pass) {
+        for (unsigned int h = 0; h < halfedges.nb_halfedges(); ++h) {
+            if (!halfedges.can_collapse(h, scratch)) continue;
+            halfedges.collapse(h, 0.5f * (halfedges.position(halfedges.origin(h)) + halfedges.position(halfedges.target(h))));
+            if (++nb_collapses % 64 == 0) check_halfedges(halfedges, name + " during the collapses");
+        }
+    }
+    check(nb_collapses > 0, name + " has collapses");
+    check_halfedges(halfedges, name + " after the collapses");
+    halfedges.compact();
+    check(halfedges.nb_faces() == halfedges.nb_remaining_faces(), name + " has no removed face after compact");
+    check_halfedges(halfedges, name + " after compact");
+
+    Mesh mesh;
+    halfedges.to_mesh(mesh);
+    HalfEdgeMesh rebuilt(mesh);
+    bool same = rebuilt.nb_halfedges() == halfedges.nb_halfedges();
+    for (unsigned int h = 0; same && h < halfedges.nb_halfedges(); ++h) {
+        same = rebuilt.origin(h) == halfedges.origin(h) && rebuilt.twin(h) == halfedges.twin(h);
+    }
+    check(same, name + " after compact has the half-edges built from its mesh");
+}
+
+bool halfedge()
+{
+    HalfEdgeMesh closed(generated(MeshGenerator::ICOSPHERE, 2000));
+    collapse_all(closed, "icosphere");
+    check(closed.nb_remaining_faces() == 4, "icosphere stops at a tetrahedron");
+
+    HalfEdgeMesh open(strip(40, 4));
+    collapse_all(open, "strip");
+    return nb_failures == 0;
+}
+
+bool streaming()
+{
+    // the plane quadrics of a flat mesh have no minimum : every cell is the average of its vertices,
+    // each vertex counted once whatever the number of its triangles
+    const std::string filename = "streaming_test.off";
+    check(write_plane(filename, 30), "the OFF file is written");
+    Mesh grid(filename.c_str(), false);
+    grid.simplify(8, GridPlacement::AVERAGE);
+    Mesh streamed;
+    check(streamed.simplifyStreaming(filename, 8, (size_t) 64 << 20, false), "the OFF file is streamed");
+    fs::remove(filename);
+
+    check(streamed.getNumberOfVertices() == grid.getNumberOfVertices(), "the streamed mesh has the cells of simplify");
+    bool averages = streamed.getNumberOfVertices() > 0;
+    for (const glm::vec3 & p : streamed.indexed_vertices) {
+        float closest = INFINITY;
+        for (const glm::vec3 & q : grid.indexed_vertices) closest = std::min(closest, glm::length(p - q));
+        averages = averages && closest < 1e-5f;
+    }
+    check(averages, "the streamed cells are the averages of simplify");
+    return nb_failures == 0;
+}
+
+bool same_mesh(const Mesh & a, const Mesh & b)
+{
+    return a.indexed_vertices == b.indexed_vertices && a.indexed_normals == b.indexed_normals && a.indices == b.indices &&
+           a.bounding_box.xpos == b.bounding_box.xpos && a.bounding_box.ypos == b.bounding_box.ypos &&
+           a.bounding_box.zpos == b.bounding_box.zpos;
+}
+
+bool cache()
+{
+    const std::string filename = "cache_test.off", cache = filename + ".mcache";
+    check(write_torus(filename, 60, 40), "the OFF file is written");
+    fs::remove(cache);
+
+    // the first load writes the cache, the second one reads it without writing it again
+    const Mesh first(filename.c_str(), true);
+    check(fs::exists(cache), "the cache is written");
+    const fs::file_time_type written = fs::last_write_time(cache);
+    const Mesh cached(filename.c_str(), true);
+    check(fs::last_write_time(cache) == written, "the cache is read");
+    const Mesh loaded(filename.c_str(), false);
+    check(loaded.getNumberOfTriangles() == 2 * 60 * 40, "the OFF file is loaded");
+    check(same_mesh(cached, loaded), "the cache has the mesh of the OFF file");
+
+    // a corrupted cache is replaced by the mesh of the OFF file
+    {
+        std::fstream file(cache, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-4, std::ios::end);
+        file.write("\xff\xff\xff\xff", 4);
+    }
+    const Mesh corrupted(filename.c_str(), true);
+    check(same_mesh(corrupted, loaded), "a corrupted cache gives the mesh of the OFF file");
+    const Mesh rebuilt(filename.c_str(), true);
+    check(same_mesh(rebuilt, loaded), "a corrupted cache is written again");
+
+    // a corrupted vertex isn't streamed either, the OFF file is streamed instead
+    {
+        std::fstream file(cache, std::ios::in | std::ios::out | std::ios::binary);
+        const float moved = 100.0f;
+        file.seekp(1024);
+        file.write(reinterpret_cast<const char *>(&moved), sizeof(float));
+    }
+    Mesh streamed, streamed_off;
+    check(streamed.simplifyStreaming(filename, 16, (size_t) 64 << 20, true), "the cache is streamed");
+    check(streamed_off.simplifyStreaming(filename, 16, (size_t) 64 << 20, false), "the OFF file is streamed");
+    check(same_mesh(streamed, streamed_off), "a corrupted cache isn't streamed");
+    fs::remove(filename);
+    fs::remove(cache);
+    return nb_failures == 0;
+}
+
+// a mesh large enough to be split in several chunks by the parallel loops, small enough for 16-bit indices
+bool determinism(const std::string & output, const std::string & reference)
+{
+    const std::string filename = "determinism_" + fs::path(output).stem().string() + ".off";
+    check(write_torus(filename, 320, 200), "the OFF file is written");
+    const Mesh loaded(filename.c_str(), false);
+    fs::remove(filename);
+    check(loaded.getNumberOfTriangles() == 2 * 320 * 200, "the OFF file is loaded");
+
+    Mesh simplified = loaded;
+    simplified.simplify(64);
+    check(simplified.getNumberOfTriangles() > 0 && simplified.getNumberOfTriangles() < loaded.getNumberOfTriangles(), "the grid simplifies the mesh");
+    Mesh decimated = loaded;
+    const std::vector<unsigned int> rounds = decimated.decimateParallel(20000);
+    check(rounds.size() > 1 && decimated.getNumberOfTriangles() <= 20000, "the parallel rounds decimate the mesh");
+    const HalfEdgeMesh halfedges(loaded);
+    std::vector<unsigned int> twins(halfedges.nb_halfedges());
+    for (unsigned int h = 0; h < halfedges.nb_halfedges(); ++h) twins[h] = halfedges.twin(h);
+
+    const std::vector<std::pair<std::string, uint64_t>> digests = {
+        {"parseOFF", digest(loaded)}, {"simplify", digest(simplified)},
+        {"decimateParallel", digest(rounds, digest(decimated))}, {"HalfEdgeMesh", digest(twins)}};
+    std::ofstream out(output);
+    for (const auto & entry : digests) out << entry.first << " " << entry.second << "\n";
+    out.close();
+
+    if (reference.empty()) return nb_failures == 0;
+    std::ifstream in(reference);
+    for (const auto & entry : digests) {
+        std::string name;
+        uint64_t value = 0;
+        in >> name >> value;
+        check(in && name == entry.first && value == entry.second, entry.first + " gives the result of " + reference);
+    }
+    return nb_failures == 0;
+}
+
+void usage(const char * program)
+{
+    std::fprintf(stderr, "usage : %s <normals | decimate_closed | decimate_open | progressive | lod | halfedge | streaming | cache | determinism <output> [reference]>\n", program);
+}
+
+} // namespace
+
+// ******************************************************************************************************
+int main(int argc, char ** argv)
+{
+    if (argc < 2)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    std::cout.setstate(std::ios::badbit);
+
+    const std::string test = argv[1];
+    bool passed;
+    if (test == "normals") passed = normals();
+    else if (test == "decimate_closed") passed = decimate_closed();
+    else if (test == "decimate_open") passed = decimate_open();
+    else if (test == "progressive") passed = progressive();
+    else if (test == "lod") passed = lod();
+    else if (test == "halfedge") passed = halfedge();
+    else if (test == "streaming") passed = streaming();
+    else if (test == "cache") passed = cache();
+    else if (test == "determinism" && argc >= 3) passed = determinism(argv[2], argc >= 4 ? argv[3] : "");
+    else
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    return passed ? 0 : 1;
+}
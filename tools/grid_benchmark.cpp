@@ -0,0 +1,89 @@
+// Compare time and memory of the dense and sparse grids used by Mesh::simplify
+// on the bundled models.
+//
+// usage : grid_benchmark [models directory] [max dense resolution]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <string>
+
+#include "Mesh.hpp"
+
+// ******************************************************************************************************
+// heap accounting : every allocation of the process goes through these operators
+static size_t g_current_bytes = 0, g_peak_bytes = 0;
+
+void * operator new (size_t size)
+{
+    // store the size in front of the block to account for it on delete
+    size_t * block = (size_t *) std::malloc(size + sizeof(std::max_align_t));
+    if (block == nullptr) throw std::bad_alloc();
+    *block = size;
+    g_current_bytes += size;
+    if (g_current_bytes > g_peak_bytes) g_peak_bytes = g_current_bytes;
+    return (char *) block + sizeof(std::max_align_t);
+}
+
+void operator delete (void * pointer) noexcept
+{
+    if (pointer == nullptr) return;
+    size_t * block = (size_t *) ((char *) pointer - sizeof(std::max_align_t));
+    g_current_bytes -= *block;
+    std::free(block);
+}
+
+void operator delete (void * pointer, size_t) noexcept { operator delete(pointer); }
+
+// ******************************************************************************************************
+int main(int argc, char ** argv)
+{
+    std::string directory = argc > 1 ? argv[1] : "assets/models";
+    unsigned int max_dense = argc > 2 ? (unsigned int) std::atoi(argv[2]) : 200;
+
+    const char * models[] = {"arma1", "camel", "elephant", "sphere", "suzanne", "teddy"};
+    const unsigned int resolutions[] = {16, 100, 200, 1024, 4096};
+
+    std::printf("%-10s %6s %8s | %12s %12s | %12s %12s\n", "model", "res", "vertices",
+                "dense ms", "dense MB", "sparse ms", "sparse MB");
+
+    for (const char * model : models)
+    {
+        // silence the loader
+        std::ostringstream log;
+        std::streambuf * cout_buffer = std::cout.rdbuf(log.rdbuf());
+        Mesh original((directory + "/" + model + ".off").c_str(), false);
+        std::cout.rdbuf(cout_buffer);
+
+        for (unsigned int resolution : resolutions)
+        {
+            double times[2] = {-1.0, -1.0}, megabytes[2] = {-1.0, -1.0};
+            unsigned int vertices = 0;
+            for (int sparse = 0; sparse < 2; ++sparse)
+            {
+                if (!sparse && resolution > max_dense) continue;
+
+                Mesh mesh = original;
+                cout_buffer = std::cout.rdbuf(log.rdbuf());
+                size_t base_bytes = g_current_bytes;
+                g_peak_bytes = g_current_bytes;
+                auto start = std::chrono::high_resolution_clock::now();
+                if (sparse) mesh.simplify(resolution); else mesh.simplifyDense(resolution);
+                auto end = std::chrono::high_resolution_clock::now();
+                std::cout.rdbuf(cout_buffer);
+
+                times[sparse] = std::chrono::duration<double>(end - start).count() * 1000.0;
+                megabytes[sparse] = (g_peak_bytes - base_bytes) / (1024.0 * 1024.0);
+                vertices = mesh.getNumberOfVertices();
+            }
+
+            std::printf("%-10s %6u %8u | ", model, resolution, vertices);
+            if (times[0] < 0.0) std::printf("%12s %12s | ", "-", "-");
+            else std::printf("%12.2f %12.2f | ", times[0], megabytes[0]);
+            std::printf("%12.2f %12.2f\n", times[1], megabytes[1]);
+        }
+    }
+    return 0;
+}
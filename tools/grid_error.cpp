@@ -0,0 +1,164 @@
+// Number of triangles the grid simplification needs to reach a given Hausdorff error, with the cell
+// representatives at the average of their vertices and at the minimum of their quadric error.
+// Each model is simplified over a geometric sweep of resolutions in both placements, the symmetric
+// Hausdorff distance to the original surface is measured for each result, and the smallest result
+// within each target error is reported.
+//
+// usage : grid_error [options] [models directory or OFF file]
+//
+//   models directory   OFF files to measure (default : assets/models)
+//
+//   --errors <list>        target errors in percent of the box diagonal (default : 0.25,0.5,1,2)
+//   --max-resolution <n>   last resolution of the sweep (default : 256)
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Mesh.hpp"
+#include "MeshDistance.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Options {
+    std::string path = "assets/models";
+    std::vector<double> errors = {0.25, 0.5, 1.0, 2.0};
+    unsigned int max_resolution = 256;
+};
+
+// one resolution of the sweep in one placement
+struct Sample {
+    unsigned int resolution = 0;
+    unsigned int triangles = 0;
+    double error = 0.0;
+};
+
+// resolutions 4, 5, 6 ... growing by 15 % up to max_resolution
+std::vector<unsigned int> sweep(unsigned int max_resolution)
+{
+    std::vector<unsigned int> resolutions;
+    for (double r = 4.0; r <= max_resolution; r *= 1.15)
+    {
+        unsigned int resolution = (unsigned int) r;
+        if (resolutions.empty() || resolution != resolutions.back()) resolutions.push_back(resolution);
+    }
+    return resolutions;
+}
+
+// smallest sample within error, nullptr when none is
+const Sample * smallest_within(const std::vector<Sample> & samples, double error)
+{
+    const Sample * best = nullptr;
+    for (const Sample & sample : samples)
+    {
+        if (sample.error <= error && sample.triangles > 0 && (best == nullptr || sample.triangles < best->triangles)) best = &sample;
+    }
+    return best;
+}
+
+std::string describe(const Sample * sample)
+{
+    if (sample == nullptr) return "-";
+    return std::to_string(sample->triangles) + " (r " + std::to_string(sample->resolution) + ")";
+}
+
+void measure_model(const std::string & model, const std::string & filename, const Options & options)
+{
+    Mesh original(filename.c_str(), false);
+    if (original.getNumberOfTriangles() == 0)
+    {
+        std::fprintf(stderr, "cannot load a triangle mesh from %s\n", filename.c_str());
+        return;
+    }
+    const double diagonal = glm::length(original.bounding_box.dimension());
+    const MeshDistance to_original(original);
+
+    // both directions : the original samples are tested against each simplified mesh
+    std::vector<Sample> samples[2];
+    const GridPlacement placements[2] = {GridPlacement::AVERAGE, GridPlacement::QUADRIC};
+    for (unsigned int resolution : sweep(options.max_resolution))
+    {
+        for (int p = 0; p < 2; ++p)
+        {
+            Mesh mesh = original;
+            mesh.simplify(resolution, placements[p]);
+            Sample sample;
+            sample.resolution = resolution;
+            sample.triangles = mesh.getNumberOfTriangles();
+            if (sample.triangles > 0)
+            {
+                sample.error = std::max(to_original.max_distance(mesh), MeshDistance(mesh).max_distance(original));
+            }
+            samples[p].push_back(sample);
+        }
+    }
+
+    std::printf("%s : %u triangles, diagonal %.4g\n", model.c_str(), original.getNumberOfTriangles(), diagonal);
+    std::printf("  %-10s %-20s %-20s %s\n", "error %", "average", "quadric", "quadric / average");
+    for (double error : options.errors)
+    {
+        const Sample * average = smallest_within(samples[0], error / 100.0 * diagonal);
+        const Sample * quadric = smallest_within(samples[1], error / 100.0 * diagonal);
+        std::string ratio = average && quadric ? std::to_string((double) quadric->triangles / average->triangles).substr(0, 4) : "-";
+        std::printf("  %-10.2f %-20s %-20s %s\n", error, describe(average).c_str(), describe(quadric).c_str(), ratio.c_str());
+    }
+}
+
+void usage(const char * program)
+{
+    std::fprintf(stderr, "usage : %s [--errors e1,e2,...] [--max-resolution n] [models directory or OFF file]\n", program);
+}
+
+} // namespace
+
+// ******************************************************************************************************
+int main(int argc, char ** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+        if (argument == "--errors" && i + 1 < argc)
+        {
+            options.errors.clear();
+            std::stringstream list(argv[++i]);
+            std::string error;
+            while (std::getline(list, error, ',')) options.errors.push_back(std::atof(error.c_str()));
+        }
+        else if (argument == "--max-resolution" && i + 1 < argc) options.max_resolution = (unsigned int) std::atoi(argv[++i]);
+        else if (argument[0] != '-') options.path = argument;
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<fs::path> files;
+    std::error_code error;
+    if (fs::is_directory(options.path, error))
+    {
+        for (const auto & entry : fs::directory_iterator(options.path, error))
+        {
+            if (entry.path().extension() == ".off") files.push_back(entry.path());
+        }
+        std::sort(files.begin(), files.end());
+    }
+    else if (fs::exists(options.path, error)) files.push_back(options.path);
+    if (files.empty() || options.errors.empty() || options.max_resolution < 4)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::printf("smallest grid simplification within each Hausdorff error (triangles, resolution), resolutions 4 to %u\n",
+                options.max_resolution);
+    for (const fs::path & file : files) measure_model(file.stem().string(), file.string(), options);
+    return 0;
+}
@@ -0,0 +1,348 @@
+// Time the stages of the mesh pipeline on the bundled models and on large generated meshes :
+// loading, grid and octree simplifications over a sweep of parameters, edge collapses to 10%
+// (serial and parallel rounds, with the Hausdorff distance of their results to the model),
+// smooth normals with the three weightings, valences and the half-edge structure. Results are
+// written in JSON and can be compared with the JSON of a previous run to flag regressions.
+//
+// usage : mesh_benchmark [options] [models directory]
+//
+//   models directory   OFF files to benchmark (default : assets/models)
+//
+//   -r <n>             timed repetitions of each case (default : 5), after one untimed run
+//   --synthetic <n>    triangles of the synthetic meshes, 0 for none (default : 2097152)
+//   --json <file>      write the results in file
+//   --baseline <file>  compare the medians with the results of a previous run
+//   --tolerance <p>    percentage of slowdown flagged as a regression (default : 10)
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <sys/resource.h>
+#endif
+
+#include "HalfEdgeMesh.hpp"
+#include "Mesh.hpp"
+#include "MeshDistance.hpp"
+#include "MeshGenerator.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Options {
+    std::string directory = "assets/models";
+    std::string json, baseline;
+    unsigned int repetitions = 5;
+    size_t synthetic = 1 << 21;
+    double tolerance = 10.0;
+};
+
+struct Result {
+    std::string name;
+    unsigned int triangles = 0;
+    double median_ms = 0.0, p95_ms = 0.0;
+    double triangles_per_second = 0.0;
+    double peak_rss_mb = 0.0;
+    double error = -1.0;        // Hausdorff distance of the result to the model over its diagonal, -1 when not measured
+};
+
+const unsigned int resolutions[] = {16, 64, 256, 1024};
+const unsigned int leaf_sizes[] = {4, 16, 64};
+
+// ******************************************************************************************************
+// peak resident set size
+//
+// On Linux the peak is reset before each case (VmHWM of /proc/self/status, reset through
+// /proc/self/clear_refs), elsewhere it is the peak of the process since it started
+void reset_peak_rss()
+{
+#if defined(__linux__)
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+#endif
+}
+
+double peak_rss_megabytes()
+{
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, 6, "VmHWM:") == 0) return std::atof(line.c_str() + 6) / 1024.0;
+    }
+#endif
+#if defined(__APPLE__)
+    struct rusage usage{};
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss / (1024.0 * 1024.0) : 0.0;
+#elif defined(__unix__)
+    struct rusage usage{};
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss / 1024.0 : 0.0;
+#else
+    return 0.0;
+#endif
+}
+
+// ******************************************************************************************************
+// run prepare (untimed) then case (timed) once untimed and repetitions times timed
+Result measure(const std::string & name, unsigned int triangles, unsigned int repetitions,
+               const std::function<void()> & prepare, const std::function<void()> & run)
+{
+    prepare(); run();
+
+    reset_peak_rss();
+    std::vector<double> times;
+    for (unsigned int r = 0; r < repetitions; ++r)
+    {
+        prepare();
+        auto start = std::chrono::steady_clock::now();
+        run();
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+
+    Result result;
+    result.name = name;
+    result.triangles = triangles;
+    result.median_ms = times.size() % 2 ? times[times.size() / 2] : (times[times.size() / 2 - 1] + times[times.size() / 2]) / 2.0;
+    // nearest rank
+    result.p95_ms = times[(size_t) std::ceil(0.95 * times.size()) - 1];
+    result.triangles_per_second = result.median_ms > 0.0 ? triangles / (result.median_ms / 1000.0) : 0.0;
+    result.peak_rss_mb = peak_rss_megabytes();
+    return result;
+}
+
+// all the cases of the model in filename
+void benchmark_model(const std::string & model, const std::string & filename, const Options & options, std::vector<Result> & results)
+{
+    Mesh original(filename.c_str(), false);
+    const unsigned int triangles = original.getNumberOfTriangles();
+    if (triangles == 0)
+    {
+        std::fprintf(stderr, "cannot load a triangle mesh from %s\n", filename.c_str());
+        return;
+    }
+    const unsigned int repetitions = options.repetitions;
+    const auto nothing = [](){};
+
+    results.push_back(measure(model + "/load", triangles, repetitions, nothing, [&](){ Mesh loaded(filename.c_str(), false); }));
+
+    // simplifications work on a fresh copy, the copy is not timed
+    Mesh mesh;
+    const auto copy = [&](){ mesh = original; };
+    for (unsigned int resolution : resolutions)
+    {
+        results.push_back(measure(model + "/simplify/" + std::to_string(resolution), triangles, repetitions, copy,
+                                  [&](){ mesh.simplify(resolution); }));
+    }
+    // copies share the octree of the original : it is built by the untimed run of the first case,
+    // the adaptive simplifications time cuts of it and its construction is timed on its own
+    std::vector<unsigned int> vertex_ids(original.getNumberOfVertices());
+    for (unsigned int v = 0; v < vertex_ids.size(); ++v) vertex_ids[v] = v;
+    LinearOctree octree;
+    const BOX & box = original.bounding_box;
+    results.push_back(measure(model + "/octree", triangles, repetitions, nothing, [&](){
+        octree.build(original.indexed_vertices, vertex_ids, glm::vec3(box.xpos.x, box.ypos.x, box.zpos.x),
+                     glm::vec3(box.xpos.y, box.ypos.y, box.zpos.y), Mesh::OCTREE_LEAF_SIZE);
+    }));
+    for (unsigned int leaf_size : leaf_sizes)
+    {
+        results.push_back(measure(model + "/adaptiveSimplify/" + std::to_string(leaf_size), triangles, repetitions, copy,
+                                  [&](){ mesh.adaptiveSimplify(leaf_size); }));
+    }
+
+    // edge collapses to 10 % : the parallel rounds are compared with the serial heap on their error as well
+    const unsigned int target = triangles / 10;
+    const float diagonal = glm::length(glm::vec3(box.xpos.y - box.xpos.x, box.ypos.y - box.ypos.x, box.zpos.y - box.zpos.x));
+    results.push_back(measure(model + "/decimate/10", triangles, repetitions, copy, [&](){ mesh.decimate(target); }));
+    results.back().error = MeshDistance::hausdorff(original, mesh) / diagonal;
+    results.push_back(measure(model + "/decimateParallel/10", triangles, repetitions, copy, [&](){ mesh.decimateParallel(target); }));
+    results.back().error = MeshDistance::hausdorff(original, mesh) / diagonal;
+
+    // normals and valences share the adjacency, timed on its own
+    results.push_back(measure(model + "/adjacency", triangles, repetitions, copy, [&](){ mesh.adjacency(); }));
+    const char * weights[] = {"uniform", "area", "angle"};
+    for (int weight = 0; weight < 3; ++weight)
+    {
+        results.push_back(measure(model + "/normals/" + weights[weight], triangles, repetitions, nothing,
+                                  [&](){ mesh.compute_smooth_vertex_normals(weight); }));
+    }
+    results.push_back(measure(model + "/valences", triangles, repetitions, nothing, [&](){ mesh.compute_vertex_valences(); }));
+    results.push_back(measure(model + "/halfedges", triangles, repetitions, nothing, [&](){ HalfEdgeMesh halfedges(original); }));
+}
+
+// ******************************************************************************************************
+// JSON : one result per line, which is what read_baseline expects
+bool write_json(const std::string & filename, const Options & options, const std::vector<Result> & results)
+{
+    std::ofstream file(filename);
+    if (!file) return false;
+    char line[512];
+    file << "{\n";
+    file << "  \"index_bits\": " << sizeof(mesh_index) * 8 << ",\n";
+    file << "  \"threads\": " << parallel_num_threads() << ",\n";
+    file << "  \"repetitions\": " << options.repetitions << ",\n";
+    file << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result & result = results[i];
+        std::snprintf(line, sizeof(line), "\"triangles\": %u, \"median_ms\": %.4f, \"p95_ms\": %.4f, "
+                      "\"triangles_per_s\": %.0f, \"peak_rss_mb\": %.2f}", result.triangles, result.median_ms,
+                      result.p95_ms, result.triangles_per_second, result.peak_rss_mb);
+        file << "    {\"name\": \"" << result.name << "\", ";
+        if (result.error >= 0.0) file << "\"error\": " << result.error << ", ";
+        file << line << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    file << "  ]\n}\n";
+    return (bool) file;
+}
+
+// medians of a JSON file written by write_json, by name
+bool read_baseline(const std::string & filename, std::map<std::string, double> & medians)
+{
+    std::ifstream file(filename);
+    if (!file) return false;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        size_t name = line.find("\"name\": \"");
+        size_t median = line.find("\"median_ms\": ");
+        if (name == std::string::npos || median == std::string::npos) continue;
+        name += 9;
+        size_t name_end = line.find('"', name);
+        if (name_end == std::string::npos) continue;
+        medians[line.substr(name, name_end - name)] = std::atof(line.c_str() + median + 13);
+    }
+    return true;
+}
+
+void usage(const char * program)
+{
+    std::fprintf(stderr, "usage : %s [-r repetitions] [--synthetic triangles] [--json file] [--baseline file] "
+                         "[--tolerance percent] [models directory]\n", program);
+}
+
+bool parse_arguments(int argc, char ** argv, Options & options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (argument == "-r" && has_value) options.repetitions = (unsigned int) std::max(1, std::atoi(argv[++i]));
+        else if (argument == "--synthetic" && has_value) options.synthetic = (size_t) std::max(0LL, std::atoll(argv[++i]));
+        else if (argument == "--json" && has_value) options.json = argv[++i];
+        else if (argument == "--baseline" && has_value) options.baseline = argv[++i];
+        else if (argument == "--tolerance" && has_value) options.tolerance = std::max(0.0, std::atof(argv[++i]));
+        else if (argument.size() > 1 && argument[0] == '-')
+        {
+            std::fprintf(stderr, "unknown option %s\n", argument.c_str());
+            return false;
+        }
+        else options.directory = argument;
+    }
+    return true;
+}
+
+} // namespace
+
+// ******************************************************************************************************
+int main(int argc, char ** argv)
+{
+    Options options;
+    if (!parse_arguments(argc, argv, options))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::map<std::string, double> baseline;
+    if (!options.baseline.empty() && !read_baseline(options.baseline, baseline))
+    {
+        std::fprintf(stderr, "cannot read baseline %s\n", options.baseline.c_str());
+        return 2;
+    }
+
+    // the log of the loader and of the simplifications is dropped
+    std::cout.setstate(std::ios::badbit);
+
+    std::vector<Result> results;
+
+    // bundled models, in name order
+    std::vector<fs::path> models;
+    std::error_code error;
+    for (const fs::directory_entry & entry : fs::directory_iterator(options.directory, error))
+    {
+        if (entry.is_regular_file() && entry.path().extension() == ".off") models.push_back(entry.path());
+    }
+    std::sort(models.begin(), models.end());
+    for (const fs::path & model : models) benchmark_model(model.stem().string(), model.string(), options, results);
+
+    // synthetic meshes of the generator (about options.synthetic triangles), written then loaded like the models
+    // (16-bit indices are limited to 65,536 vertices)
+    const size_t triangles = sizeof(mesh_index) == 2 ? std::min<size_t>(options.synthetic, 120000) : options.synthetic;
+    for (MeshGenerator::Shape shape : {MeshGenerator::ICOSPHERE, MeshGenerator::TERRAIN, MeshGenerator::SOUP})
+    {
+        if (triangles == 0) break;
+        MeshGenerator generator(shape, triangles);
+        const std::string model = std::string(MeshGenerator::shape_name(shape)) + "_" + std::to_string(generator.getNumberOfTriangles());
+        const fs::path filename = fs::temp_directory_path(error) / ("mesh_benchmark_" + model + ".off");
+        if (!generator.write_OFF_file(filename.string()))
+        {
+            std::fprintf(stderr, "cannot write the synthetic mesh %s\n", filename.string().c_str());
+            continue;
+        }
+        benchmark_model(model, filename.string(), options, results);
+        fs::remove(filename, error);
+    }
+    std::cout.clear();
+
+    if (results.empty())
+    {
+        std::fprintf(stderr, "nothing to benchmark in %s\n", options.directory.c_str());
+        return 1;
+    }
+
+    // report, with the change of the median against the baseline
+    unsigned int nb_regressions = 0;
+    std::printf("%-40s %10s %12s %12s %14s %10s %10s %10s\n", "case", "triangles", "median ms", "p95 ms", "Mtriangles/s",
+                "peak MB", "error %", "baseline");
+    for (const Result & result : results)
+    {
+        std::printf("%-40s %10u %12.3f %12.3f %14.2f %10.1f", result.name.c_str(), result.triangles, result.median_ms,
+                    result.p95_ms, result.triangles_per_second / 1e6, result.peak_rss_mb);
+        if (result.error >= 0.0) std::printf(" %10.4f", 100.0 * result.error);
+        else std::printf(" %10s", "-");
+        auto reference = baseline.find(result.name);
+        if (reference != baseline.end() && reference->second > 0.0)
+        {
+            const double change = 100.0 * (result.median_ms / reference->second - 1.0);
+            // changes of a few microseconds are noise whatever their percentage
+            const bool regression = change > options.tolerance && result.median_ms - reference->second > 0.05;
+            if (regression) nb_regressions++;
+            std::printf(" %+9.1f%%%s", change, regression ? "  REGRESSION" : "");
+        }
+        std::printf("\n");
+    }
+
+    if (!options.json.empty() && !write_json(options.json, options, results))
+    {
+        std::fprintf(stderr, "cannot write %s\n", options.json.c_str());
+        return 1;
+    }
+    if (!baseline.empty())
+    {
+        std::printf("%u regression(s) over %.0f%% against %s\n", nb_regressions, options.tolerance, options.baseline.c_str());
+    }
+    return nb_regressions == 0 ? 0 : 1;
+}
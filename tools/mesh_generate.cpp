@@ -0,0 +1,93 @@
+// Write a deterministic procedural mesh in an OFF file, for tests at scale.
+// The mesh is formatted block by block : memory doesn't grow with the number of triangles.
+//
+// usage : mesh_generate [--seed n] <icosphere | terrain | soup> <triangles> <output>
+//
+//   icosphere   subdivided icosahedron on the unit sphere
+//   terrain     heightfield of fractal noise
+//   soup        many small noisy closed components, like a scan
+//   triangles   approximate number of triangles, with an optional k, M or G suffix (e.g. 10M)
+//   output      OFF file
+//
+//   --seed <n>  seed of the noise (default : 0)
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <sys/resource.h>
+#endif
+
+#include "MeshGenerator.hpp"
+
+namespace {
+
+// peak resident set size of the process in MB, 0 when unknown
+double peak_rss_megabytes()
+{
+#if defined(__APPLE__)
+    struct rusage usage{};
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss / (1024.0 * 1024.0) : 0.0;
+#elif defined(__unix__)
+    struct rusage usage{};
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss / 1024.0 : 0.0;
+#else
+    return 0.0;
+#endif
+}
+
+// "250000", "10M" ... 0 when invalid
+size_t parse_count(const std::string & text)
+{
+    char * end = nullptr;
+    double count = std::strtod(text.c_str(), &end);
+    if (end == text.c_str()) return 0;
+    std::string suffix = end;
+    if (suffix == "k" || suffix == "K") count *= 1e3;
+    else if (suffix == "m" || suffix == "M") count *= 1e6;
+    else if (suffix == "g" || suffix == "G") count *= 1e9;
+    else if (!suffix.empty()) return 0;
+    return count > 0.0 ? (size_t) count : 0;
+}
+
+void usage(const char * program)
+{
+    std::fprintf(stderr, "usage : %s [--seed n] <icosphere | terrain | soup> <triangles> <output>\n", program);
+}
+
+} // namespace
+
+// ******************************************************************************************************
+int main(int argc, char ** argv)
+{
+    uint32_t seed = 0;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+        if (argument == "--seed" && i + 1 < argc) seed = (uint32_t) std::strtoul(argv[++i], nullptr, 10);
+        else positional.push_back(argument);
+    }
+
+    MeshGenerator::Shape shape;
+    size_t nb_triangles = positional.size() == 3 ? parse_count(positional[1]) : 0;
+    if (positional.size() != 3 || !MeshGenerator::parse_shape(positional[0], shape) || nb_triangles == 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    MeshGenerator generator(shape, nb_triangles, seed);
+    auto start = std::chrono::steady_clock::now();
+    if (!generator.write_OFF_file(positional[2])) return 1;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%s : %zu vertices, %zu triangles written in %s in %.2f s (%.2f Mtriangles/s), peak RSS %.2f MB\n",
+                MeshGenerator::shape_name(shape), generator.getNumberOfVertices(), generator.getNumberOfTriangles(),
+                positional[2].c_str(), seconds, seconds > 0.0 ? generator.getNumberOfTriangles() / seconds / 1e6 : 0.0,
+                peak_rss_megabytes());
+    return 0;
+}
@@ -0,0 +1,320 @@
+// Simplify OFF meshes without a window : one file, or every OFF file of a directory
+// with several meshes processed at the same time.
+//
+// usage : mesh_simplify [options] <input> <grid | octree | target | edge | pedge | lod | progressive | stream> <parameter> <output>
+//
+//   input         OFF file, or directory of OFF files
+//   grid          Mesh::simplify, parameter is the resolution of the grid
+//   octree        Mesh::adaptiveSimplify, parameter is the number of vertices per leaf
+//   target        Mesh::simplifyToTarget, parameter is the maximum number of triangles
+//   edge          Mesh::decimate, parameter is the number of triangles to keep
+//   pedge         Mesh::decimateParallel, parameter is the number of triangles to keep, the number of
+//                 collapses of each round is reported
+//   lod           Mesh::buildLODChain, parameter is the number of levels (halving the triangles) : level l
+//                 is written to <output>_lod<l>.off
+//   progressive   Mesh::buildProgressiveMesh, parameter is the number of triangles of the base mesh : the base
+//                 is written, the size of the vertex splits and the time to refine them all are reported
+//   stream        Mesh::simplifyStreaming, parameter is the resolution of the grid : the input
+//                 is read block by block without being loaded, for meshes larger than memory
+//   output        OFF file, or directory (created if needed) when input is a directory
+//
+//   -j <n>        number of meshes processed at the same time (default : number of threads)
+//   --cache       read / write the binary cache next to the input files
+//   --budget <n>  memory budget in MB of each streamed mesh (default : 1024)
+//   --quadric     grid, target : place the cell representatives at the minimum of their quadric error
+//   -v            keep the log of the loader and of the simplifications
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <sys/resource.h>
+#endif
+
+#include "Mesh.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+enum class Mode { GRID, OCTREE, TARGET, EDGE, PEDGE, LOD, PROGRESSIVE, STREAM };
+
+struct Options {
+    std::string input, output;
+    Mode mode = Mode::GRID;
+    unsigned int parameter = 0;
+    unsigned int workers = 0;
+    size_t budget = (size_t) 1024 << 20;
+    bool cache = false;
+    bool quadric = false;
+    bool verbose = false;
+};
+
+// peak resident set size of the process in MB, 0 when unknown
+double peak_rss_megabytes()
+{
+#if defined(__APPLE__)
+    struct rusage usage{};
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss / (1024.0 * 1024.0) : 0.0;
+#elif defined(__unix__)
+    struct rusage usage{};
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss / 1024.0 : 0.0;
+#else
+    return 0.0;
+#endif
+}
+
+double milliseconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void usage(const char * program)
+{
+    std::fprintf(stderr, "usage : %s [-j workers] [--cache] [--budget MB] [--quadric] [-v] <input> <grid | octree | target | edge | pedge | lod | progressive | stream> <parameter> <output>\n", program);
+}
+
+bool parse_arguments(int argc, char ** argv, Options & options)
+{
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+        if (argument == "-j" && i + 1 < argc) options.workers = (unsigned int) std::max(1, std::atoi(argv[++i]));
+        else if (argument == "--cache") options.cache = true;
+        else if (argument == "--budget" && i + 1 < argc) options.budget = (size_t) std::max(1, std::atoi(argv[++i])) << 20;
+        else if (argument == "--quadric") options.quadric = true;
+        else if (argument == "-v") options.verbose = true;
+        else if (argument.size() > 1 && argument[0] == '-')
+        {
+            std::fprintf(stderr, "unknown option %s\n", argument.c_str());
+            return false;
+        }
+        else positional.push_back(argument);
+    }
+    if (positional.size() != 4) return false;
+
+    options.input = positional[0];
+    if (positional[1] == "grid") options.mode = Mode::GRID;
+    else if (positional[1] == "octree") options.mode = Mode::OCTREE;
+    else if (positional[1] == "target") options.mode = Mode::TARGET;
+    else if (positional[1] == "edge") options.mode = Mode::EDGE;
+    else if (positional[1] == "pedge") options.mode = Mode::PEDGE;
+    else if (positional[1] == "lod") options.mode = Mode::LOD;
+    else if (positional[1] == "progressive") options.mode = Mode::PROGRESSIVE;
+    else if (positional[1] == "stream") options.mode = Mode::STREAM;
+    else
+    {
+        std::fprintf(stderr, "unknown mode %s, expected grid, octree, target, edge, pedge, lod, progressive or stream\n", positional[1].c_str());
+        return false;
+    }
+    int parameter = std::atoi(positional[2].c_str());
+    if (parameter <= 0)
+    {
+        std::fprintf(stderr, "parameter must be a positive integer\n");
+        return false;
+    }
+    options.parameter = (unsigned int) parameter;
+    options.output = positional[3];
+    return true;
+}
+
+// write the simplified mesh, the report of the stage is appended to report
+bool write(const Mesh & mesh, const std::string & output, std::string & report)
+{
+    char line[64];
+    auto start = std::chrono::steady_clock::now();
+    bool written = mesh.write_OFF_file(output);
+    std::snprintf(line, sizeof(line), "  %-10s %10.2f ms ", "write", milliseconds_since(start));
+    report += line + output + (written ? "\n" : " (failed)\n");
+    return written;
+}
+
+// load, simplify and write one mesh, the report of each stage is appended to report
+bool process(const Options & options, const std::string & input, const std::string & output, std::string & report)
+{
+    char line[256];
+    report += input + "\n";
+
+    // the streamed mesh is simplified while it is read
+    if (options.mode == Mode::STREAM)
+    {
+        auto start = std::chrono::steady_clock::now();
+        Mesh mesh;
+        if (!mesh.simplifyStreaming(input, options.parameter, options.budget, options.cache))
+        {
+            report += "  cannot stream a triangle mesh within the memory budget\n";
+            return false;
+        }
+        std::snprintf(line, sizeof(line), "  %-10s %10.2f ms %10u vertices %10u triangles %10.2f MB\n", "stream",
+                      milliseconds_since(start), mesh.getNumberOfVertices(), mesh.getNumberOfTriangles(),
+                      mesh.memory_usage() / (1024.0 * 1024.0));
+        report += line;
+        return write(mesh, output, report);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Mesh mesh(input.c_str(), options.cache);
+    double load_ms = milliseconds_since(start);
+    if (mesh.getNumberOfTriangles() == 0)
+    {
+        report += "  cannot load a triangle mesh\n";
+        return false;
+    }
+    std::snprintf(line, sizeof(line), "  %-10s %10.2f ms %10u vertices %10u triangles %10.2f MB\n", "load", load_ms,
+                  mesh.getNumberOfVertices(), mesh.getNumberOfTriangles(), mesh.memory_usage() / (1024.0 * 1024.0));
+    report += line;
+
+    // the levels of detail are written one by one from the chain
+    if (options.mode == Mode::LOD)
+    {
+        start = std::chrono::steady_clock::now();
+        const LODChain chain = mesh.buildLODChain(options.parameter);
+        std::snprintf(line, sizeof(line), "  %-10s %10.2f ms %10zu vertices shared by %u levels %10.2f MB\n", "lod",
+                      milliseconds_since(start), chain.vertices.size(), chain.getNumberOfLevels(),
+                      (chain.vertices.size() * sizeof(glm::vec3) + chain.indices.size() * sizeof(mesh_index)) / (1024.0 * 1024.0));
+        report += line;
+        if (chain.getNumberOfLevels() == 0) return false;
+
+        const fs::path path(output);
+        bool written = true;
+        for (unsigned int level = 0; level < chain.getNumberOfLevels(); ++level)
+        {
+            Mesh level_mesh;
+            chain.extract(level, level_mesh);
+            std::snprintf(line, sizeof(line), "  level %-4u %10u vertices %10u triangles\n", level, level_mesh.getNumberOfVertices(),
+                          level_mesh.getNumberOfTriangles());
+            report += line;
+            fs::path level_path = path;
+            level_path.replace_filename(path.stem().string() + "_lod" + std::to_string(level) + path.extension().string());
+            written = write(level_mesh, level_path.string(), report) && written;
+        }
+        return written;
+    }
+
+    // the base mesh is written, the splits are applied to time the refinement
+    if (options.mode == Mode::PROGRESSIVE)
+    {
+        start = std::chrono::steady_clock::now();
+        ProgressiveMesh pm = mesh.buildProgressiveMesh(options.parameter);
+        const double build_ms = milliseconds_since(start);
+        Mesh base;
+        pm.extract(base);
+        std::snprintf(line, sizeof(line), "  %-10s %10.2f ms %10u vertices %10u triangles %10.2f MB\n", "base",
+                      build_ms, base.getNumberOfVertices(), base.getNumberOfTriangles(), base.memory_usage() / (1024.0 * 1024.0));
+        report += line;
+
+        start = std::chrono::steady_clock::now();
+        pm.setNumberOfVertices(std::numeric_limits<unsigned int>::max());
+        std::snprintf(line, sizeof(line), "  %-10s %10.2f ms %10zu splits %10zu corners %10.2f MB\n", "refine",
+                      milliseconds_since(start), pm.splits.size(), pm.corners.size(),
+                      (pm.splits.size() * sizeof(ProgressiveMesh::VertexSplit) + pm.corners.size() * sizeof(unsigned int)) / (1024.0 * 1024.0));
+        report += line;
+        return write(base, output, report);
+    }
+
+    start = std::chrono::steady_clock::now();
+    std::vector<unsigned int> rounds;
+    const GridPlacement placement = options.quadric ? GridPlacement::QUADRIC : GridPlacement::AVERAGE;
+    if (options.mode == Mode::GRID) mesh.simplify(options.parameter, placement);
+    else if (options.mode == Mode::TARGET) mesh.simplifyToTarget(options.parameter, placement);
+    else if (options.mode == Mode::EDGE) mesh.decimate(options.parameter);
+    else if (options.mode == Mode::PEDGE) rounds = mesh.decimateParallel(options.parameter);
+    else mesh.adaptiveSimplify(options.parameter);
+    double simplify_ms = milliseconds_since(start);
+    std::snprintf(line, sizeof(line), "  %-10s %10.2f ms %10u vertices %10u triangles %10.2f MB\n",
+                  options.mode == Mode::GRID ? "grid" : options.mode == Mode::TARGET ? "target" : options.mode == Mode::EDGE ? "edge" : options.mode == Mode::PEDGE ? "pedge" : "octree", simplify_ms,
+                  mesh.getNumberOfVertices(), mesh.getNumberOfTriangles(), mesh.memory_usage() / (1024.0 * 1024.0));
+    report += line;
+    if (!rounds.empty())
+    {
+        report += "  " + std::to_string(rounds.size()) + " rounds :";
+        for (unsigned int nb_collapses : rounds) report += " " + std::to_string(nb_collapses);
+        report += "\n";
+    }
+
+    return write(mesh, output, report);
+}
+
+} // namespace
+
+// ******************************************************************************************************
+int main(int argc, char ** argv)
+{
+    Options options;
+    if (!parse_arguments(argc, argv, options))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // inputs and outputs : a file, or the OFF files of a directory in name order
+    std::vector<std::pair<std::string, std::string>> jobs;
+    std::error_code error;
+    if (fs::is_directory(options.input, error))
+    {
+        fs::create_directories(options.output, error);
+        if (!fs::is_directory(options.output, error))
+        {
+            std::fprintf(stderr, "cannot create directory %s\n", options.output.c_str());
+            return 1;
+        }
+        for (const fs::directory_entry & entry : fs::directory_iterator(options.input, error))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == ".off")
+            {
+                jobs.emplace_back(entry.path().string(), (fs::path(options.output) / entry.path().filename()).string());
+            }
+        }
+        std::sort(jobs.begin(), jobs.end());
+    }
+    else jobs.emplace_back(options.input, options.output);
+
+    if (jobs.empty())
+    {
+        std::fprintf(stderr, "no OFF file in %s\n", options.input.c_str());
+        return 1;
+    }
+
+    // the mesh log goes to std::cout : a failed stream drops it unless asked for, without
+    // any buffer shared by the workers. Reports are printed with stdio
+    if (!options.verbose) std::cout.setstate(std::ios::badbit);
+
+    // workers take the next job until there are none left, reports are printed whole
+    const unsigned int nb_workers = std::min<unsigned int>(options.workers ? options.workers : parallel_num_threads(),
+                                                           (unsigned int) jobs.size());
+    std::atomic<size_t> next_job{0};
+    std::atomic<unsigned int> nb_failures{0};
+    std::mutex print_mutex;
+    auto start = std::chrono::steady_clock::now();
+
+    auto work = [&](){
+        for (size_t job = next_job++; job < jobs.size(); job = next_job++)
+        {
+            std::string report;
+            if (!process(options, jobs[job].first, jobs[job].second, report)) nb_failures++;
+            std::lock_guard<std::mutex> lock(print_mutex);
+            std::fputs(report.c_str(), stdout);
+            std::fflush(stdout);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned int w = 1; w < nb_workers; ++w) threads.emplace_back(work);
+    work();
+    for (std::thread & thread : threads) thread.join();
+
+    std::cout.clear();
+    std::printf("%zu mesh(es), %u failure(s), %u worker(s), %.2f ms, peak RSS %.2f MB\n", jobs.size(), nb_failures.load(),
+                nb_workers, milliseconds_since(start), peak_rss_megabytes());
+    return nb_failures == 0 ? 0 : 1;
+}